@@ -1,3 +1,4 @@
 #!/bin/bash
 
-exec ncat -kl -m1 -vvv -e lib/basic/test/bin/bastos 127.0.0.1 1967
+# Multi-session server, one interpreter per telnet / Minitel connection
+exec lib/basic/test/bin/bastos-server 1967 "$(nproc)" 127.0.0.1
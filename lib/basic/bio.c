@@ -37,6 +37,14 @@
 #include "bmemory.h"
 #include "token.h"
 #include "eval.h"
+#include "vm.h"
+#include "output.h"
+#include "number.h"
+#include "mat.h"
+#include "bst.h"
+#include "profile.h"
+#include "videotex.h"
+#include "screen.h"
 #include "bio.h"
 #include "os.h"
 
@@ -44,37 +52,97 @@
 #include "token.c-static"
 #include "bmemory.c-static"
 #include "string.c-static"
+#include "number.c-static"
+#include "mat.c-static"
 #include "eval.c-static"
+#include "vm.c-static"
+#include "bst.c-static"
+#include "profile.c-static"
+#include "output.c-static"
+#include "videotex.c-static"
+#include "screen.c-static"
 #include "os.c-static"
 
-void bastos_init(void)
+int8_t bastos_init(void)
 {
-    bmem_init(malloc(BASTOS_MEMORY_SIZE), BASTOS_MEMORY_SIZE);
+    return bastos_init_size(BASTOS_MEMORY_SIZE);
+}
+
+// Start a session with an interpreter memory of the given size, system
+// variables included. The size must fit the heap offsets (bsize_t). Without
+// memory, there is no current session.
+int8_t bastos_init_size(uint32_t size)
+{
+    bmem = 0;
+    if (size < BASTOS_MEMORY_MIN || size > (bsize_t) -1)
+        return BERROR_RANGE;
+    size &= ~(BASTOS_MEMORY_ALIGN - 1);
+
+    uint8_t *mem = malloc(size);
+    if (!mem)
+        return BERROR_MEMORY;
+
+    bmem_init(mem, size);
+    return BERROR_NONE;
 }
 
 void bastos_done()
 {
+    if (bmem)
+        output_drain();
     free(bmem);
     bmem = 0;
 }
 
+// The interpreter state of the current session. A host running several
+// sessions switches between them with bastos_context_set().
+void *bastos_context_get()
+{
+    return bmem;
+}
+
+void bastos_context_set(void *context)
+{
+    bmem = (bmem_t *) context;
+}
+
 bool bastos_is_reset()
 {
     return bmem == 0 || bmem->bstate.reset;
 }
 
+// Forget the keys received and the lines not handled yet
+static void bastos_io_clear()
+{
+    bmem->io_head = bmem->io_tail = 0;
+    bmem->io_line_len = 0;
+    bmem->io_lines = 0;
+}
+
+// Append a key to the io ring buffer. The first IO_LINE_SIZE bytes are
+// mirrored after its end, so that any line can be read in place.
+static inline void bastos_io_put(uint8_t key)
+{
+    uint16_t head = bmem->io_head;
+    bmem->io_buffer[head] = key;
+    if (head < IO_LINE_SIZE)
+        bmem->io_buffer[head + IO_BUFFER_SIZE] = key;
+    bmem->io_head = (head + 1) & (IO_BUFFER_SIZE - 1);
+}
+
 static void bastos_handle_ctrl_c()
 {
     bastos_stop();
-    *bmem->io_buffer = 0;
-    hal_print_string("**Break**\r\n");
+    bastos_io_clear();
+    output_string("**Break**\r\n");
 }
 
+// Store the keys in the io buffer and return how many were taken. When the
+// buffer is full, the caller sends the remaining keys later.
 size_t bastos_send_keys(const char *keys, size_t n, bool echo)
 {
     size_t m = 0;
-    uint8_t *src = (uint8_t *)keys;
-    uint8_t *dst = bmem->io_buffer;
+    const uint8_t *src = (const uint8_t *)keys;
 
     // If no keys, do nothing
     if (n == 0 || src == 0 || *src == 0)
@@ -96,87 +164,89 @@ size_t bastos_send_keys(const char *keys, size_t n, bool echo)
         return 1;
     }
 
-    // Find the terminal 0 in io buffer
-    for (; *dst; dst++)
-        ;
-
-    // Copy keys at the end of io buffer
-    size_t size = dst - bmem->io_buffer;
-    while (size < IO_BUFFER_SIZE - 1 && *src && n > 0)
+    for (; m < n && src[m]; m++)
     {
-        if (*src == 3)
+        uint8_t key = src[m];
+        uint16_t used = (bmem->io_head - bmem->io_tail) & (IO_BUFFER_SIZE - 1);
+
+        if (key == 3)
         {
             bastos_stop();
-            *bmem->io_buffer = 0;
-            return 1;
+            bastos_io_clear();
+            return m + 1;
         }
-        else if (*src == '\r')
+        else if (key == '\r' || key == '\n')
         {
-            *dst++ = '\n';
-            src++;
-            if (echo) hal_print_string("\r\n");
+            if (used == IO_BUFFER_SIZE - 1)
+                break;
+            bastos_io_put('\n');
+            bmem->io_line_len = 0;
+            bmem->io_lines++;
+            if (echo) output_string(key == '\r' ? "\r\n" : "\n");
         }
-        else if (*src == 127)
+        else if (key == 127)
         {
-            if (dst - bmem->io_buffer >= 1 && *(dst - 1) != '\n')
+            if (bmem->io_line_len > 0)
             {
-                dst--;
-                *dst = 0;
-                if (echo) hal_print_string(DEL);
+                bmem->io_head = (bmem->io_head - 1) & (IO_BUFFER_SIZE - 1);
+                bmem->io_line_len--;
+                if (echo) output_string(DEL);
             }
         }
         else
         {
-            uint8_t *c = dst;
-            *dst++ = *src++;
-            *dst = 0;
-            size++;
-            if (echo) hal_print_string((char *) c);
+            // Keys after the maximum line length are dropped
+            if (bmem->io_line_len >= IO_LINE_KEYS)
+                continue;
+            // Keep room for the end of the line
+            if (used >= IO_BUFFER_SIZE - 2)
+                break;
+            bastos_io_put(key);
+            bmem->io_line_len++;
+            if (echo) output_write((const char *) &key, 1);
         }
-        size = dst - bmem->io_buffer;
-        n--;
-        m++;
     }
-    *dst = 0;
 
     return m;
 }
 
+// Handle the oldest complete line of the io buffer
 int8_t bastos_input()
 {
     int8_t err = BERROR_NONE;
 
-    // Find first command end
-    uint8_t *next = bmem->io_buffer;
-    while (*next && *next != '\n')
-    {
-        next++;
-    }
-
     // If no command: do nothing
-    if (*next == 0)
+    if (bmem->io_lines == 0)
         return BERROR_NONE;
 
-    // Mark first command end with 0 and point to next one
-    *next++ = 0;
-
-    // Prepare move of the next commands to buffer start
-    uint8_t *src = next;
-    uint8_t *dst = bmem->io_buffer;
+    // The line is contiguous thanks to the mirror: terminate it in place and
+    // release it from the ring
+    uint8_t *command = bmem->io_buffer + bmem->io_tail;
+    uint8_t *end = memchr(command, '\n', IO_LINE_SIZE);
+    *end = 0;
+    bmem->io_tail = (bmem->io_tail + (end - command) + 1) & (IO_BUFFER_SIZE - 1);
+    bmem->io_lines--;
 
     // Manage INPUT command
     if (eval_inputting())
     {
-        err = eval_input_store((char *) bmem->io_buffer);
+        err = eval_input_store((char *) command);
         goto finalize;
     }
 
     // Tokenize command and handle tokenize error case
     tokenizer_state_t line;
-    err = tokenize(&line, (char *) bmem->io_buffer);
+    err = tokenize(&line, (char *) command);
     if (err < 0)
         goto finalize;
 
+    // Editing the program moves the lines: forget pointers to them. The
+    // other commands get the lines contiguous.
+    if (line.line_no != 0)
+        running_state_clear();
+    else
+        bmem_prog_gap_close();
+
     // Allocate memory for the prog line
     uint16_t len = line.write_ptr - line.read_ptr;
     prog_t *prog = bmem_prog_line_new(line.line_no, line.read_ptr, len);
@@ -197,29 +267,22 @@ int8_t bastos_input()
         goto finalize;
     }
 
-    // If line number is 0, evaluate and remove
+    // Compute the constants of a program line once for all
+    if (prog->line_no != 0)
+        prog = eval_fold_line(prog);
+
+    // If line number is 0, evaluate it. It is the token buffer, not a line of
+    // the program: there is nothing to remove, even after a LOAD.
     if (prog->line_no == 0)
     {
-        bool is_load = prog->line[0] == TOKEN_KEYWORD_LOAD;
         err = eval_prog(prog, true);
-        if (!is_load)
-        {
-            bmem_prog_line_free(prog);
-        }
     }
 
 finalize:
-    // remove first command
-    while (*src)
-    {
-        *dst++ = *src++;
-    }
-    *dst = 0;
-
     // Handle error
     if (err != BERROR_NONE)
     {
-        hal_print_integer("Error %d\r\n", (int)-err);
+        output_integer("Error %d\r\n", (int)-err);
     }
 
     return err;
@@ -230,106 +293,110 @@ bool bastos_running()
     return eval_running();
 }
 
-int8_t bastos_save(const char *name)
+bool bastos_inputting()
 {
-    int fd = hal_open(name, B_CREAT | B_RDWR);
-    if (fd < 0) {
-        goto err;
-    }
-
-    // save prog
-    // Write prog total size
-    uint16_t prog_size = bmem->prog_end - bmem->prog_start;
-    if (hal_write(fd, &prog_size, sizeof(prog_size)) < 0) {
-        goto err;
-    }
-
-    // Write prog
-    if (hal_write(fd, bmem->prog_start, prog_size) < 0) {
-        goto err;
-    }
+    return eval_inputting();
+}
 
-    // save vars
-    // Write vars total size
-    uint16_t vars_size = bmem->vars_end - bmem->vars_start;
-    if (hal_write(fd, &vars_size, sizeof(vars_size)) < 0) {
-        goto err;
-    }
+// Set the execution quantum of bastos_loop(), at least one line
+void bastos_set_quantum(uint16_t lines, uint32_t us)
+{
+    bmem->quantum_lines = lines != 0 ? lines : 1;
+    bmem->quantum_us = us;
+}
 
-    // Write vars
-    if (hal_write(fd, bmem->vars_start, vars_size) < 0) {
-        goto err;
+// Activity, memory and allocator counters since bastos_init() or the last
+// reset
+void bastos_stats(bastos_stats_t *stats, bool reset)
+{
+    bmem_free_mark();
+    stats->lines = bmem->lines_run - bmem->stats_lines;
+    stats->heap_size = bmem_heap_size();
+    stats->heap_free = bmem->vars_start - bmem->strings_end;
+    stats->heap_free_min = bmem->free_min;
+    stats->strings_peak = bmem->counters.strings_peak;
+    stats->vars_peak = bmem->counters.vars_peak;
+    stats->string_allocs = bmem->counters.string_allocs;
+    stats->string_bytes = bmem->counters.string_bytes;
+    stats->var_allocs = bmem->counters.var_allocs;
+    stats->var_unsets = bmem->counters.var_unsets;
+    stats->moves = bmem->counters.moves;
+    stats->bytes_moved = bmem->counters.bytes_moved;
+
+    if (reset)
+    {
+        bmem->stats_lines = bmem->lines_run;
+        bmem->free_min = stats->heap_free;
+        bmem_counters_reset();
     }
+}
 
-    hal_close(fd);
-    return 0;
+// Program lines run since bastos_init(). The keys of a session replayed at the
+// same steps, with a quantum without time limit, give the same run.
+uint32_t bastos_steps()
+{
+    return bmem->lines_run;
+}
 
-err:
-    if (fd >= 0) {
-        hal_close(fd);
-    }
-    return -1;
+int8_t bastos_save(const char *name)
+{
+    return bst_save(name, BASTOS_SECTION_PROG | BASTOS_SECTION_VARS);
 }
 
 int8_t bastos_load(const char *name)
 {
-    int8_t err = BERROR_NONE;
-    int fd = hal_open(name, B_RDONLY);
+    return bst_load(name, BASTOS_SECTION_PROG | BASTOS_SECTION_VARS, 0);
+}
 
-    if (fd < 0)
-        return BERROR_IO;
+// Save only the program or the variables
+int8_t bastos_save_sections(const char *name, uint8_t sections)
+{
+    return bst_save(name, sections);
+}
 
-    bastos_prog_new();
+// Load the program or the variables of a file, keeping the other ones
+int8_t bastos_load_sections(const char *name, uint8_t sections)
+{
+    return bst_load(name, sections, 0);
+}
 
-    int bread;
+// Load the variables of the names (a null terminated list) from a file. They
+// replace the ones of the same names, the others are kept.
+int8_t bastos_load_vars(const char *name, const char **names)
+{
+    return bst_load(name, BASTOS_SECTION_VARS, names);
+}
 
-    // load prog
-    uint16_t prog_size;
-    bread = hal_read(fd, &prog_size, sizeof(prog_size));
-    if (bread != sizeof(prog_size))
-    {
-        err = BERROR_IO;
-        goto finalize;
-    }
-    if (prog_size >= bmem->vars_start - bmem->prog_start)
-    {
-        err = BERROR_IO;
-        goto finalize;
-    }
-    if (hal_read(fd, bmem->prog_start, prog_size) != prog_size)
-    {
-        err = BERROR_IO;
-        goto finalize;
-    }
-    bmem->prog_end = bmem->prog_start + prog_size;
-    bmem_strings_clear();
+#if BASTOS_PROFILE
+// Start profiling the program lines run, with counters set to 0, or stop
+void bastos_profile(bool on)
+{
+    if (on)
+        profile_start();
+    else
+        profile_stop();
+}
 
-    // load vars
-    uint16_t vars_size;
-    bread = hal_read(fd, &vars_size, sizeof(vars_size));
-    if (bread != sizeof(vars_size))
-    {
-        err = BERROR_IO;
-        goto finalize;
-    }
-    if (vars_size >= bmem->vars_end - bmem->prog_end)
-    {
-        err = BERROR_IO;
-        goto finalize;
-    }
-    bmem->vars_start = bmem->vars_end - vars_size;
-    if (hal_read(fd, bmem->vars_start, vars_size) != vars_size)
+// Copy the profile of the lines that ran, in line order. Return the count of
+// lines copied.
+uint16_t bastos_profile_get(bastos_profile_t *lines, uint16_t max)
+{
+    uint16_t n = 0;
+    for (uint16_t pos = 0; pos < profile_count() && n < max; pos++)
     {
-        err = BERROR_IO;
-        bmem_vars_clear();
-        goto finalize;
+        profile_t *line = profile_lines() + pos;
+        if (line->hits == 0)
+            continue;
+
+        lines[n].line_no = bmem_prog_line_at(pos)->line_no;
+        lines[n].hits = line->hits;
+        lines[n].us = line->us;
+        lines[n].bytes = line->bytes;
+        n++;
     }
-
-finalize:
-    hal_close(fd);
-    bmem->bstate.read_ptr = 0;
-    return err;
+    return n;
 }
+#endif
 
 void bastos_stop()
 {
@@ -343,15 +410,43 @@ void bastos_loop()
 
     if (eval_running() && !eval_inputting())
     {
-        eval_prog_next();
-        if (bmem->bstate.reset)
-            return;
+        // Run lines until the program stops, waits for input or uses its
+        // quantum, then return so that keys (and Ctrl+C) are read
+        uint16_t lines = bmem->quantum_lines;
+        uint32_t start = bmem->quantum_us != 0 ? hal_micros() : 0;
+        do
+        {
+#if BASTOS_PROFILE
+            if (bmem->profiling)
+                profile_prog_next();
+            else
+#endif
+                vm_prog_next();
+            if (bmem->bstate.reset)
+                return;
+        } while (--lines != 0 && eval_running() && !eval_inputting() &&
+                 (bmem->quantum_us == 0 || hal_micros() - start < bmem->quantum_us));
+        bmem->lines_run += bmem->quantum_lines - lines;
 
         if (!eval_running())
         {
-            hal_print_string("Ready\r\n");
+            output_string("Ready\r\n");
         }
-        return;
     }
-    bastos_input();
+    else
+    {
+        // Handle the lines received, until one of them runs a program
+        while (bmem->io_lines != 0 && !bmem->bstate.reset &&
+               (!eval_running() || eval_inputting()))
+        {
+            bastos_input();
+        }
+    }
+
+#if BASTOS_SCREEN
+    screen_update();
+#endif
+
+    // Write what the device accepts now, the rest goes with the next loops
+    output_flush(0);
 }
@@ -45,6 +45,37 @@ extern "C"
 #define B_TRUNC   01000
 #define B_APPEND  02000
 
+// Execution quantum: bastos_loop() runs program lines until one of these
+// limits is reached, then returns to let the caller handle I/O
+#ifndef BASTOS_QUANTUM_LINES
+#define BASTOS_QUANTUM_LINES (256)
+#endif
+#ifndef BASTOS_QUANTUM_US
+#define BASTOS_QUANTUM_US (10000) // 0 for no time limit
+#endif
+
+// Size or offset in the interpreter memory. The targets keep 16 bits and a
+// memory up to 64 KB; a host builds with BASTOS_HEAP_32 set to 1 for more.
+#ifndef BASTOS_HEAP_32
+#define BASTOS_HEAP_32 0
+#endif
+
+// Set BASTOS_PROFILE to 0 to build without the per-line profiler (PROFILE)
+#ifndef BASTOS_PROFILE
+#define BASTOS_PROFILE 1
+#endif
+
+// Set BASTOS_VM to 0 to run programs with the evaluator only
+#ifndef BASTOS_VM
+#define BASTOS_VM 1
+#endif
+
+#if BASTOS_HEAP_32
+typedef uint32_t bsize_t;
+#else
+typedef uint16_t bsize_t;
+#endif
+
 typedef struct {
     uint16_t line_no;
     uint16_t len;
@@ -54,10 +85,11 @@ typedef struct {
 typedef struct {
     uint8_t token;
     uint8_t dim_count;    // 0 for simple vars
-    uint16_t name_ofs;    // Offset of the var name in var.bytes array
+    bsize_t name_ofs;     // Offset of the var name in var.bytes array
     union {
         uint32_t dims[0]; // size of each dimension. Do not exists in simple vars
         float numbers[0]; // 1st element at numbers[dim_count], sizeof(float) == sizeof(uint32_t)
+        int32_t integers[0]; // Same layout as numbers, for integer vars
         uint8_t bytes[0]; // 1st element at bytes[dim_count * size_of(uint32_t)]
         char string[0];   // Single string for simple vars
     };
@@ -68,17 +100,59 @@ static inline char *name_of_var(var_t *var)
     return (char *)var->bytes + var->name_ofs;
 }
 
-void bastos_init(void);
+typedef struct {
+    uint32_t lines;         // Program lines run
+    bsize_t heap_size;     // Interpreter memory, system variables included
+    bsize_t heap_free;     // Free memory now
+    bsize_t heap_free_min; // Lowest free memory seen
+    bsize_t strings_peak;  // Largest string memory seen
+    bsize_t vars_peak;     // Largest variables memory seen
+    uint32_t string_allocs;
+    uint32_t string_bytes; // String memory allocated
+    uint32_t var_allocs;
+    uint32_t var_unsets;
+    uint32_t moves;        // Memory moved by the allocator...
+    uint32_t bytes_moved;  // ...and its size
+} bastos_stats_t;
+
+// Profile of a program line, see bastos_profile_get()
+typedef struct {
+    uint16_t line_no;
+    uint32_t hits;  // Times the line was run
+    uint32_t us;    // Time running the line
+    uint32_t bytes; // String memory allocated by the line
+} bastos_profile_t;
+
+int8_t bastos_init(void);
+int8_t bastos_init_size(uint32_t size);
 void bastos_done(void);
 bool bastos_is_reset(void);
+void *bastos_context_get(void);
+void bastos_context_set(void *context);
 
 size_t bastos_send_keys(const char *keys, size_t n, bool echo);
 void bastos_loop(void);
 bool bastos_running(void);
+bool bastos_inputting(void);
 void bastos_stop(void);
+void bastos_set_quantum(uint16_t lines, uint32_t us);
+void bastos_stats(bastos_stats_t *stats, bool reset);
+uint32_t bastos_steps(void);
+
+// Sections of a saved file
+#define BASTOS_SECTION_PROG (1 << 0)
+#define BASTOS_SECTION_VARS (1 << 1)
 
 int8_t bastos_save(const char *name);
 int8_t bastos_load(const char *name);
+int8_t bastos_save_sections(const char *name, uint8_t sections);
+int8_t bastos_load_sections(const char *name, uint8_t sections);
+int8_t bastos_load_vars(const char *name, const char **names);
+
+#if BASTOS_PROFILE
+void bastos_profile(bool on);
+uint16_t bastos_profile_get(bastos_profile_t *lines, uint16_t max);
+#endif
 
 void bastos_prog_new(void);
 var_t *bastos_var_get(const char *name);
@@ -30,15 +30,52 @@
 
 #include "bio.h"
 #include "eval.h"
+#include "output.h"
 
+// Default size of the interpreter memory, see bastos_init_size()
+#ifndef BASTOS_MEMORY_SIZE
 #define BASTOS_MEMORY_SIZE (16 * 1024)
-#define BASTOS_MEMORY_ALIGN (sizeof(uint32_t))
+#endif
+
+// Tables of the system variables. With 16-bit heap offsets the memory is
+// the 16 KB of the target, they are kept small to leave it to programs.
+#if BASTOS_HEAP_32
+#define IO_BUFFER_SIZE  (256) // Ring buffer of the keys, must be a power of 2
+#define B_VAR_HASH_SIZE (128) // Must be a power of 2
+#else
 #define IO_BUFFER_SIZE  (128)
+#define B_VAR_HASH_SIZE (64)  // Hashes 48 variables, at its 3/4 load
+#endif
+
+// Smallest interpreter memory: the system variables, and room for a short
+// program and its variables
+#define BASTOS_MEMORY_MIN (sizeof(bmem_t) + 1024)
+#define BASTOS_MEMORY_ALIGN (sizeof(uint32_t))
+#define IO_LINE_SIZE    (128) // Longest input line, end of line included
+// Keys of a line taken by the ring, end of line excluded. The ring keeps a
+// free slot and needs one for the end of the line, the keys after are dropped.
+#define IO_LINE_KEYS (IO_LINE_SIZE - 1 < IO_BUFFER_SIZE - 2 ? IO_LINE_SIZE - 1 : IO_BUFFER_SIZE - 2)
 #define TOKEN_LINE_SIZE (128)
 #define EVAL_RETURNS_SIZE (32)
+#define EVAL_LOOPS_SIZE (16) // Nested FOR loops, see README.md
+#define EVAL_ARRAY_SITES (8)  // Array references cached, must be a power of 2
+#define EVAL_STRING_PIECES (16)
+#define EVAL_FOLDS_MAX (8) // Constant expressions folded in a line
 #define B_DIM_MAX (16)
 #define B_DIM_RANGE_FLAG (128)
 #define B_NAME_SIZE_MAX (16)
+#define B_PROG_GAP_STEP (64)    // Growth of the gap of the program lines
+#define B_PROG_INDEX_STEP (16)  // Growth of the line index, in lines
+
+// Storage class of the interpreter state pointer. A host that runs sessions
+// on several threads defines it as _Thread_local.
+#ifndef BASTOS_TLS
+#define BASTOS_TLS
+#endif
+
+#define B_CODE_NONE (0)   // Program not compiled yet
+#define B_CODE_READY (1)  // Compiled program stored after the variables
+#define B_CODE_FAILED (2) // Not enough memory, run with the evaluator
 
 typedef struct {
     uint16_t line_no;
@@ -46,20 +83,57 @@ typedef struct {
     uint8_t line[TOKEN_LINE_SIZE];
 } prog_buffer_t;
 
+// FOR loop frame. The limit and step are of the type of the variable.
 typedef struct
 {
-    float limit;
-    float step;
-    prog_t *for_line;
+    union {
+        float limit;
+        int32_t int_limit;
+    };
+    union {
+        float step;
+        int32_t int_step;
+    };
+    char *name;        // Token and name of the variable, in the FOR line
+    prog_t *body;      // Line after the FOR line
+    uint16_t body_pos; // Its position in the line index
+    bsize_t var;       // Offset of the variable from vars_end...
+    uint16_t vars_gen; // ...valid for this variables generation
 } loop_t;
 
 typedef struct
 {
-    uint16_t line_no;
+    prog_t *next;
 } return_t;
 
+#define EVAL_FOLD_EXPR  (0) // eval_expr()
+#define EVAL_FOLD_FLOAT (1) // eval_float_expr()
+#define EVAL_FOLD_TTY   (2) // eval_string_tty()
+
+// Constant expression found by the syntax check of a line, that
+// eval_fold_line() replaces by its value
+typedef struct
+{
+    uint8_t start; // Offsets of the source tokens in the line
+    uint8_t end;
+    uint8_t type;  // EVAL_FOLD_EXPR, EVAL_FOLD_FLOAT or EVAL_FOLD_TTY
+} fold_t;
+
+// Array found for a reference in a program line
+typedef struct
+{
+    char *name;        // Name of the reference, in the program line
+    bsize_t var;       // Offset of the array from vars_end...
+    uint16_t vars_gen; // ...valid for this variables generation
+} array_site_t;
+
 #define B_GOTO_FLAG (1 << 0)
 
+// Kinds of the number of an expression
+#define B_NUMBER_FLOAT (0)
+#define B_NUMBER_INT   (1) // Integer variable or result of an integer operator
+#define B_NUMBER_CONST (2) // Integral constant, an integer next to an integer
+
 // Bastos evaluation state
 typedef struct
 {
@@ -68,6 +142,8 @@ typedef struct
     char *var_ref;
     var_t *input_var;
     float number;
+    int32_t integer;     // Value of the number, unless number_kind is B_NUMBER_FLOAT
+    uint8_t number_kind;
     uint8_t *read_ptr;
     uint8_t token;
     uint8_t input_var_token;
@@ -79,24 +155,86 @@ typedef struct
     bool inputting;
     bool reset;
     int sp;
+    uint16_t vm_pos; // Line index position of pc, when running compiled code
     char *string;
+    uint8_t *print_ptr; // Start of the PRINT item being evaluated
+    uint16_t reads;     // Count of variables and keys read, constant while the
+                        // expression evaluated is made of constants
+    uint32_t effects;   // Output written, numbers drawn, keys read, program,
+                        // variables or files dropped: a line failing before
+                        // any can be run again
+    fold_t *folds;      // Constant expressions found, while folding a line
+    uint8_t fold_count;
     prog_buffer_t token_buffer;
 } eval_state_t;
 
+// Allocator counters, since bmem_init() or the last reset of bastos_stats()
+typedef struct
+{
+    bsize_t strings_peak;  // Largest string memory seen
+    bsize_t vars_peak;     // Largest variables memory seen
+    uint32_t string_allocs;
+    uint32_t string_bytes; // String memory allocated
+    uint32_t var_allocs;
+    uint32_t var_unsets;
+    uint32_t moves;        // Memory moved to make room or close a hole...
+    uint32_t bytes_moved;  // ...and its size
+} bmem_counters_t;
+
 // Bastos low memory system variables
 typedef struct {
     uint8_t *prog_start;
     uint8_t *prog_end;
     uint8_t *strings_end;
+    uint16_t line_count;
+    uint16_t line_slots; // Capacity of the line index
+    uint16_t gap_pos;    // Lines before the gap, see bmem_prog_line_at()
+    uint8_t *gap_start;
+    bsize_t gap_size;
+    bsize_t code_size;
+    uint8_t code_state;
+    uint16_t var_hash_count;
+    bool var_hash_overflow;
+#if BASTOS_PROFILE
+    bool profiling;
+    bsize_t profile_size; // Line profile, at the end of the memory
+#endif
+#if BASTOS_SCREEN
+    bsize_t screen_size; // Shadow screen cells, after the line profile
+#endif
+    uint16_t vars_gen; // Incremented each time variables move
+    uint16_t quantum_lines;
+    uint32_t quantum_us;
+    bool fkey; // os_get_key() got a function key prefix
+    uint32_t lines_run;   // Program lines run by bastos_loop() since bmem_init()
+    uint32_t stats_lines; // lines_run at the last reset of bastos_stats()
+    bsize_t free_min;   // Lowest free memory seen
+    bmem_counters_t counters;
     uint8_t *vars_start;
     uint8_t *vars_end;
     eval_state_t bstate;
-    loop_t loops['Z' - 'A' + 1];
+    loop_t loops[EVAL_LOOPS_SIZE]; // Stack of the running loops
+    uint8_t loop_count;
+    array_site_t array_sites[EVAL_ARRAY_SITES];
     return_t returns[EVAL_RETURNS_SIZE];
-    uint8_t io_buffer[IO_BUFFER_SIZE];
+    bsize_t var_hash[B_VAR_HASH_SIZE];
+    uint16_t io_head;    // Next key position in io_buffer
+    uint16_t io_tail;    // Start of the oldest line not handled
+    uint8_t io_line_len; // Length of the line being received
+    uint8_t io_lines;    // Complete lines waiting in io_buffer
+    uint8_t io_buffer[IO_BUFFER_SIZE + IO_LINE_SIZE]; // Ring, then mirror of its start
+    uint16_t output_len;
+    char output_buffer[OUTPUT_BUFFER_SIZE];
+#if BASTOS_VIDEOTEX
+    videotex_t videotex; // Model of the screen, for the output optimizer
+#endif
+#if BASTOS_SCREEN
+    screen_t screen; // Shadow screen of SCREEN 1 and 2
+#endif
 } bmem_t;
 
-static void bmem_init(uint8_t *mem, uint16_t size);
+static void bmem_init(uint8_t *mem, bsize_t size);
+static bsize_t bmem_heap_size();
 
 // prog related functions
 static void bmem_prog_line_free(prog_t *prog);
@@ -104,24 +242,75 @@ static prog_t *bmem_prog_line_new(uint16_t line_no, uint8_t *line, uint16_t len)
 static prog_t *bmem_prog_first_line();
 static prog_t *bmem_prog_next_line(prog_t *prog);
 static prog_t *bmem_prog_get_line_or_next(uint16_t line_no);
+static inline uint8_t *bmem_prog_top();
+static void bmem_prog_clear();
+static void bmem_prog_gap_close();
+static void bmem_vars_moved();
+static void bmem_code_clear();
+#if BASTOS_VM
+static void bmem_code_commit(bsize_t size);
+#endif
+#if BASTOS_PROFILE
+static uint8_t *bmem_profile();
+static bool bmem_profile_alloc(bsize_t size);
+static void bmem_profile_free();
+#endif
+#if BASTOS_SCREEN
+static uint8_t *bmem_screen();
+static bool bmem_screen_alloc(bsize_t size);
+static void bmem_screen_free();
+#endif
 
 // var related functions
 static void bmem_vars_clear();
+static void bmem_var_name_typed(const char *name, char *typed_name);
+static var_t *bmem_var_string_new(const char *name, bsize_t capacity);
 static var_t *bmem_var_string_set(const char *name, char *value);
 static var_t *bmem_var_number_set(const char *name, float value);
+static var_t *bmem_var_integer_set(const char *name, int32_t value);
 static var_t *bmem_var_first();
 static var_t *bmem_var_next(var_t *var);
+static float *bmem_number_array_cell(var_t *var, uint8_t dim_count, uint32_t *indexes);
+static int32_t *bmem_integer_array_cell(var_t *var, uint8_t dim_count, uint32_t *indexes);
+static bsize_t bmem_array_cells(var_t *var);
 
 // string related functions
-static char *bmem_string_alloc(uint16_t size);
+static void bmem_free_mark(void);
+static void bmem_counters_reset(void);
+static char *bmem_string_alloc(bsize_t size);
 static void bmem_strings_clear();
 
-static void string_slice(char **string, uint16_t start, uint16_t end);
-static void string_concat(char **string1, char *string2);
+static void string_slice(char **string, bsize_t start, bsize_t end);
+static char *string_join(char **pieces, uint8_t count);
 
 static inline int bmem_align4(int size)
 {
     return (size + BASTOS_MEMORY_ALIGN - 1) & ~(BASTOS_MEMORY_ALIGN - 1);
 }
 
+// True if a float is an integer that an integer variable can hold
+static inline bool bmem_float_is_int(float value)
+{
+    return value >= -2147483648.0f && value < 2147483648.0f && (float) (int32_t) value == value;
+}
+
+// Convert a float to an integer variable value: truncated and saturated, NaN
+// is 0
+static inline int32_t bmem_float_to_int(float value)
+{
+    if (value >= 2147483648.0f)
+        return INT32_MAX;
+    if (value <= -2147483648.0f)
+        return INT32_MIN;
+    return value == value ? (int32_t) value : 0;
+}
+
+// Operators work on integers if both operands are integers or integral
+// constants, and one of them at least is an integer. Constants alone keep
+// the float arithmetic.
+static inline bool bmem_int_operands(uint8_t kind1, uint8_t kind2)
+{
+    return kind1 != B_NUMBER_FLOAT && kind2 != B_NUMBER_FLOAT && ((kind1 | kind2) & B_NUMBER_INT) != 0;
+}
+
 #endif // __BMEMORY_H__
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __BST_H__
+#define __BST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bio.h"
+
+// A .bst file starts with a header and the index of its sections, followed by
+// the sections in the index order. The index and each section have a CRC-32.
+// A file without the magic has the first layout: the program size (uint16_t)
+// and the program, then the variables size and the raw variables of a 16-bit
+// heap.
+#define BST_MAGIC "BST\x1a"
+#define BST_VERSION (1)
+#define BST_SECTIONS_MAX (4)
+#define BST_CHUNK_SIZE (256) // Flash page, unit of the file reads and writes
+
+typedef struct
+{
+    char magic[4];
+    uint8_t version;
+    uint8_t section_count;
+    uint16_t reserved;
+    uint32_t index_crc; // CRC-32 of the section index
+} bst_header_t;
+
+typedef struct
+{
+    uint8_t type; // BASTOS_SECTION_PROG or BASTOS_SECTION_VARS
+    uint8_t reserved[3];
+    uint32_t size;
+    uint32_t crc; // CRC-32 of the bytes of the section
+} bst_section_t;
+
+// A variable of the variables section, followed by its data and its name. The
+// record does not depend on the width of bsize_t.
+typedef struct
+{
+    uint8_t token;
+    uint8_t dim_count;
+    uint8_t name_size;  // Name and its null char
+    uint8_t reserved;
+    uint32_t data_size; // Dims, then cells or string: name_ofs of the variable
+} bst_var_t;
+
+// File read or written a chunk at a time. count and crc are those of the
+// bytes of the current section. A writer without file only measures.
+typedef struct
+{
+    int fd;
+    uint32_t count;
+    uint32_t crc;
+    uint16_t pos; // Position in chunk
+    uint16_t len; // Bytes read in chunk
+    bool error;
+    uint8_t chunk[BST_CHUNK_SIZE];
+} bst_stream_t;
+
+static uint32_t bst_crc32(uint32_t crc, const uint8_t *data, uint32_t n);
+static int8_t bst_save(const char *name, uint8_t sections);
+static int8_t bst_load(const char *name, uint8_t sections, const char **names);
+
+#endif // __BST_H__
@@ -82,6 +82,16 @@ poke
 usr
 eval
 bastos
+mat
+sum
+min
+max
+find
+prog
+vars
+profile
+screen
+refresh
 EOF
 
 # Do not sort to preserve save/load compatibility
@@ -116,3 +126,72 @@ while IFS= read -r keyword; do
     ((index++))
 done < ${KEYWORDS_FILE}
 echo ";" >>${KEYWORDS_C}
+
+# Offsets of the keywords in the string above, for untokenize
+echo >>${KEYWORDS_C}
+echo "// Offset of each keyword in keywords, and offset of the end" >>${KEYWORDS_C}
+echo "static const uint16_t keyword_offsets[] = {" >>${KEYWORDS_C}
+offset=0
+while IFS= read -r keyword; do
+    echo "    ${offset}," >>${KEYWORDS_C}
+    ((offset+=${#keyword}))
+done < ${KEYWORDS_FILE}
+echo "    ${offset}" >>${KEYWORDS_C}
+echo "};" >>${KEYWORDS_C}
+
+# Perfect hash of the uppercase keywords, for tokenize: find the first
+# initial value and seed with no collision in a 256 entries table. Must match
+# keyword_hash_next() in token.c-static.
+awk '
+{
+    keyword[NR] = toupper($0)
+    if (length($0) > len_max)
+        len_max = length($0)
+}
+END {
+    for (i = 0; i < 256; i++)
+        code[sprintf("%c", i)] = i
+    for (init = 0; init < 256; init++)
+    {
+        for (seed = 1; seed < 65536; seed += 2)
+        {
+            delete slot
+            for (k = 1; k <= NR; k++)
+            {
+                h = init
+                for (i = 1; i <= length(keyword[k]); i++)
+                    h = ((h + code[substr(keyword[k], i, 1)]) * seed) % 65536
+                h = int(h / 256)
+                if (h in slot)
+                    break
+                slot[h] = k
+            }
+            if (k > NR)
+                break
+        }
+        if (seed < 65536)
+            break
+    }
+    if (init >= 256)
+    {
+        print "No perfect hash seed found" > "/dev/stderr"
+        exit 1
+    }
+
+    print ""
+    printf "#define KEYWORD_COUNT (%d)\n", NR
+    printf "#define KEYWORD_LEN_MAX (%d)\n", len_max
+    printf "#define KEYWORD_HASH_INIT (%d)\n", init
+    printf "#define KEYWORD_HASH_SEED (%d)\n", seed
+    print ""
+    print "// Keyword index + 1 for each hash value of an uppercase word, 0 if none"
+    print "static const uint8_t keyword_hash[256] = {"
+    for (i = 0; i < 256; i += 16)
+    {
+        line = "   "
+        for (j = i; j < i + 16; j++)
+            line = line sprintf(" %d,", (j in slot) ? slot[j] : 0)
+        print line
+    }
+    print "};"
+}' ${KEYWORDS_FILE} >>${KEYWORDS_C}
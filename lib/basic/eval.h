@@ -37,9 +37,13 @@ static bool eval_inputting();
 static void eval_stop();
 static int8_t eval_input_store(char *io_string);
 static int8_t eval_prog_next();
+static int8_t eval_prog_done(prog_t *pc, int8_t err);
+static prog_t *eval_fold_line(prog_t *prog);
+static void eval_fold_prog();
 
 static bool eval_string_expr();
 static bool eval_factor();
 static bool eval_expr(uint8_t type_token);
+static bool eval_int_binary(uint8_t op, int32_t a, int32_t b, int32_t *result);
 
 #endif // __EVAL_H__
@@ -70,3 +70,13 @@
 #define TOKEN_KEYWORD_USR ((uint8_t) (68 | 0b10000000))
 #define TOKEN_KEYWORD_EVAL ((uint8_t) (69 | 0b10000000))
 #define TOKEN_KEYWORD_BASTOS ((uint8_t) (70 | 0b10000000))
+#define TOKEN_KEYWORD_MAT ((uint8_t) (71 | 0b10000000))
+#define TOKEN_KEYWORD_SUM ((uint8_t) (72 | 0b10000000))
+#define TOKEN_KEYWORD_MIN ((uint8_t) (73 | 0b10000000))
+#define TOKEN_KEYWORD_MAX ((uint8_t) (74 | 0b10000000))
+#define TOKEN_KEYWORD_FIND ((uint8_t) (75 | 0b10000000))
+#define TOKEN_KEYWORD_PROG ((uint8_t) (76 | 0b10000000))
+#define TOKEN_KEYWORD_VARS ((uint8_t) (77 | 0b10000000))
+#define TOKEN_KEYWORD_PROFILE ((uint8_t) (78 | 0b10000000))
+#define TOKEN_KEYWORD_SCREEN ((uint8_t) (79 | 0b10000000))
+#define TOKEN_KEYWORD_REFRESH ((uint8_t) (80 | 0b10000000))
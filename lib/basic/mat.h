@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __MAT_H__
+#define __MAT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bio.h"
+
+// Set BASTOS_MAT_SIMD to 0 to build the array kernels without the GCC vector
+// types. With them, the host build runs 4 cells per SIMD instruction, and the
+// targets without SIMD get the same code unrolled.
+#ifndef BASTOS_MAT_SIMD
+#ifdef __GNUC__
+#define BASTOS_MAT_SIMD 1
+#else
+#define BASTOS_MAT_SIMD 0
+#endif
+#endif
+
+static void mat_fill(uint32_t *dst, uint32_t value, bsize_t n);
+static void mat_fill_string(char *dst, bsize_t width, const char *value, bsize_t n);
+static void mat_op_float(uint8_t op, float *dst, const float *a, const float *b, bsize_t n);
+static void mat_op_int(uint8_t op, int32_t *dst, const int32_t *a, const int32_t *b, bsize_t n);
+static void mat_scale_float(float *dst, float k, const float *a, bsize_t n);
+static void mat_scale_int(int32_t *dst, int32_t k, const int32_t *a, bsize_t n);
+static float mat_sum_float(const float *a, bsize_t n);
+static int32_t mat_sum_int(const int32_t *a, bsize_t n);
+static float mat_min_max_float(const float *a, bsize_t n, bool max);
+static int32_t mat_min_max_int(const int32_t *a, bsize_t n, bool max);
+static bsize_t mat_find_float(const float *a, float value, bsize_t n);
+static bsize_t mat_find_int(const int32_t *a, int32_t value, bsize_t n);
+static bsize_t mat_find_string(const char *a, bsize_t width, const char *value, bsize_t n);
+
+#endif // __MAT_H__
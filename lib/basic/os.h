@@ -32,12 +32,16 @@
 extern "C" {
 #endif
 
-void os_bootstrap(void);
+int8_t os_bootstrap(void);
+int8_t os_bootstrap_size(uint32_t size);
 uint8_t os_get_key(void);
 
 uint8_t hal_get_key(void);
+uint32_t hal_micros(void);
+// Write at most count bytes without waiting, return the number written (0 if
+// the device is busy, -1 if it is gone)
+int hal_output(const char *buffer, int count);
 int hal_print_string(const char *s);
-int hal_print_float(float f);
 int hal_print_integer(const char *format, int i);
 int hal_open(const char *pathname, int flags);
 int hal_close(int fd);
@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <stdint.h>
+
+#include "videotex.h"
+#include "screen.h"
+
+// Interpreter output is collected in bmem->output_buffer and written to the
+// HAL in large chunks: when the buffer is full, at the end of bastos_loop(),
+// before INKEY$ and before the HAL prints by itself (CAT, FAST, WIFI...). The
+// 16 KB target has a smaller one: 128 bytes take half the writes of 64 bytes
+// (447 against 894 for the 55 KB of the screen-paint bench) for 64 bytes.
+#if BASTOS_HEAP_32
+#define OUTPUT_BUFFER_SIZE (256)
+#else
+#define OUTPUT_BUFFER_SIZE (128)
+#endif
+
+static void output_write(const char *data, uint16_t len);
+static void output_put(const char *data, uint16_t len);
+static void output_send(uint16_t room);
+static void output_string(const char *s);
+static void output_float(float f);
+static void output_int(int32_t i);
+static void output_integer(const char *format, int i);
+static void output_flush(uint16_t room);
+static void output_drain(void);
+
+#endif // __OUTPUT_H__
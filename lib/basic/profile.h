@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdint.h>
+
+#include "bio.h"
+
+#if BASTOS_PROFILE
+
+#define PROFILE_REPORT_LINES (10) // Lines listed by PROFILE
+
+// Counters of a program line. The profile has one for each line of the line
+// index, in the same order.
+typedef struct
+{
+    uint32_t hits;
+    uint32_t us;
+    uint32_t bytes;
+} profile_t;
+
+static void profile_start();
+static void profile_stop();
+static void profile_report(uint16_t n);
+static int8_t profile_prog_next();
+
+#endif // BASTOS_PROFILE
+
+#endif // __PROFILE_H__
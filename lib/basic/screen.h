@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SCREEN_H__
+#define __SCREEN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "videotex.h"
+
+// Set BASTOS_SCREEN to 0 to build without the shadow screen of SCREEN and
+// REFRESH. It repaints through the Minitel output optimizer.
+#ifndef BASTOS_SCREEN
+#define BASTOS_SCREEN BASTOS_VIDEOTEX
+#endif
+
+#if BASTOS_SCREEN && !BASTOS_VIDEOTEX
+#error "BASTOS_SCREEN needs BASTOS_VIDEOTEX"
+#endif
+
+// SCREEN modes
+#define SCREEN_OFF    (0) // Output sent as the program writes it
+#define SCREEN_AUTO   (1) // Changes sent at the end of a quantum and at INKEY$
+#define SCREEN_MANUAL (2) // Changes sent on REFRESH
+
+#define SCREEN_ROWS (VIDEOTEX_ROWS + 1) // Status row 0 included
+#define SCREEN_COLS (VIDEOTEX_COLS)
+#define SCREEN_CELLS (SCREEN_ROWS * SCREEN_COLS)
+#define SCREEN_RUN_GAP (2) // Unchanged cells sent again rather than moving
+
+// Cell attributes: ink, paper and the mosaic character set
+#define SCREEN_INK_MASK   (0x07)
+#define SCREEN_PAPER_MASK (0x38)
+#define SCREEN_PAPER_SHIFT (3)
+#define SCREEN_MOSAIC     (0x40)
+#define SCREEN_ATTR_DEFAULT ((VIDEOTEX_INK_DEFAULT - 0x40) | \
+                             (VIDEOTEX_PAPER_DEFAULT - 0x50) << SCREEN_PAPER_SHIFT)
+#define SCREEN_PAPER_DEFAULT (SCREEN_ATTR_DEFAULT & SCREEN_PAPER_MASK)
+#define SCREEN_UNKNOWN (0) // Character of a cell whose content is not known
+
+typedef struct
+{
+    uint8_t c;
+    uint8_t attr;
+} screen_cell_t;
+
+// Shadow screen state. Its cells are at the end of the memory: the screen the
+// program wrote, then the screen sent.
+typedef struct
+{
+    uint8_t mode;
+    uint8_t seq[VIDEOTEX_SEQ_SIZE]; // Sequence being received
+    uint8_t seq_len;
+    uint8_t row;  // Cursor, 0 being the status row
+    uint8_t col;  // ...and column from 1
+    uint8_t attr; // Attributes of the next character
+    uint8_t zone; // Paper validated by the last alphanumeric space of the row
+    uint8_t last; // Last character written, for REP
+} screen_t;
+
+#if BASTOS_SCREEN
+static bool screen_start(uint8_t mode);
+static void screen_stop(void);
+static void screen_write(const char *data, uint16_t len);
+static void screen_refresh(void);
+static void screen_update(void);
+static void screen_forget(void);
+#endif
+
+#endif // __SCREEN_H__
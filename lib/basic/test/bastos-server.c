@@ -0,0 +1,407 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "bio.h"
+#include "os.h"
+
+/*
+ * BASTOS server: one process, many telnet / Minitel sessions.
+ *
+ * Each session has its own interpreter state (bastos_context_get/set). The
+ * main thread accepts connections and hands them to a pool of workers, each
+ * with its own epoll instance. A worker feeds the received keys to its
+ * sessions and gives each running program one quantum per round.
+ */
+
+#define SERVER_PORT (1967)
+#define SERVER_EVENTS (64)
+#define SESSION_IN_SIZE (1024)
+#define SESSION_OUT_HIGH (64 * 1024) // Programs wait above this pending output
+#define SESSION_OUT_MAX (1024 * 1024)
+#define SESSION_QUANTUM_LINES (64)
+#define SESSION_QUANTUM_US (2000)
+#define SESSION_HEAP_MIN (16 * 1024)
+#if BASTOS_HEAP_32
+#define SESSION_HEAP_SIZE (256 * 1024) // Interpreter memory of a session
+#else
+#define SESSION_HEAP_SIZE SESSION_HEAP_MIN
+#endif
+
+typedef struct session
+{
+    int fd;
+    void *context;
+    uint8_t in[SESSION_IN_SIZE];
+    size_t in_pos;
+    size_t in_len;
+    bool in_pending; // More input to read from fd
+    char keys[SESSION_IN_SIZE]; // Keys translated by os_get_key(), not taken yet
+    size_t keys_len;
+    char *out;
+    size_t out_pos;
+    size_t out_len;
+    size_t out_size;
+    bool closing;
+    bool active;
+    struct session *next_active;
+} session_t;
+
+typedef struct
+{
+    pthread_t thread;
+    int epfd;
+    session_t *active; // Sessions with keys to handle or a program to run
+} worker_t;
+
+static _Thread_local session_t *current;
+static bsize_t heap_size = SESSION_HEAP_SIZE;
+
+/* HAL: keys and output of the current session */
+
+uint8_t hal_get_key()
+{
+    if (!current || current->in_pos >= current->in_len)
+        return 0;
+    return current->in[current->in_pos++];
+}
+
+static int session_write(session_t *s, const char *data, size_t len)
+{
+    if (s->out_len + len > s->out_size)
+    {
+        size_t size = s->out_size ? s->out_size : 4096;
+        while (size < s->out_len + len)
+            size *= 2;
+        if (size > SESSION_OUT_MAX)
+        {
+            s->closing = true;
+            return 0;
+        }
+        char *out = realloc(s->out, size);
+        if (!out)
+        {
+            s->closing = true;
+            return 0;
+        }
+        s->out = out;
+        s->out_size = size;
+    }
+    memcpy(s->out + s->out_len, data, len);
+    s->out_len += len;
+    return len;
+}
+
+int hal_output(const char *buffer, int count)
+{
+    if (!current)
+        return -1;
+    return session_write(current, buffer, count);
+}
+
+int hal_print_string(const char *s)
+{
+    if (!current)
+        return 0;
+    return session_write(current, s, strlen(s));
+}
+
+int hal_print_integer(const char *format, int32_t i)
+{
+    char buffer[64];
+    int n = snprintf(buffer, sizeof(buffer), format, i);
+    return hal_print_string(buffer) ? n : 0;
+}
+
+/* Sessions */
+
+// Start the interpreter of a session, return false without memory for it
+static bool session_bootstrap(session_t *s)
+{
+    s->context = 0;
+    if (os_bootstrap_size(heap_size) != BERROR_NONE)
+        return false;
+    bastos_set_quantum(SESSION_QUANTUM_LINES, SESSION_QUANTUM_US);
+    s->context = bastos_context_get();
+    return true;
+}
+
+static session_t *session_new(int fd)
+{
+    session_t *s = calloc(1, sizeof(session_t));
+    if (!s)
+        return 0;
+
+    s->fd = fd;
+    current = s;
+    bool ok = session_bootstrap(s);
+    current = 0;
+    if (!ok)
+    {
+        free(s);
+        return 0;
+    }
+    return s;
+}
+
+static void session_free(session_t *s)
+{
+    bastos_context_set(s->context);
+    bastos_done();
+    close(s->fd);
+    free(s->out);
+    free(s);
+}
+
+static void session_read(session_t *s)
+{
+    s->in_pending = false;
+    if (s->in_pos == s->in_len)
+        s->in_pos = s->in_len = 0;
+
+    while (s->in_len < SESSION_IN_SIZE)
+    {
+        ssize_t n = read(s->fd, s->in + s->in_len, SESSION_IN_SIZE - s->in_len);
+        if (n > 0)
+        {
+            s->in_len += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n < 0 && errno == EINTR)
+            continue;
+        s->closing = true;
+        return;
+    }
+
+    // Buffer full: read the rest once keys are consumed
+    s->in_pending = true;
+}
+
+static void session_flush(session_t *s)
+{
+    while (s->out_pos < s->out_len)
+    {
+        ssize_t n = write(s->fd, s->out + s->out_pos, s->out_len - s->out_pos);
+        if (n > 0)
+        {
+            s->out_pos += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n < 0 && errno == EINTR)
+            continue;
+        s->closing = true;
+        return;
+    }
+    s->out_pos = s->out_len = 0;
+}
+
+static bool session_busy(session_t *s)
+{
+    if (s->closing)
+        return false;
+    if (s->out_len - s->out_pos >= SESSION_OUT_HIGH)
+        return false; // Wait for EPOLLOUT
+    return s->in_pos < s->in_len || s->in_pending || s->keys_len != 0 ||
+           (bastos_running() && !bastos_inputting());
+}
+
+// Feed the received keys to the interpreter and run one quantum
+static bool session_run(session_t *s)
+{
+    bastos_context_set(s->context);
+    current = s;
+
+    size_t taken;
+    do
+    {
+        while (s->keys_len < SESSION_IN_SIZE && s->in_pos < s->in_len)
+        {
+            char key = os_get_key();
+            if (key != 0)
+                s->keys[s->keys_len++] = key;
+        }
+
+        taken = bastos_send_keys(s->keys, s->keys_len, true);
+        memmove(s->keys, s->keys + taken, s->keys_len - taken);
+        s->keys_len -= taken;
+
+        bastos_loop();
+        if (bastos_is_reset())
+        {
+            bastos_done();
+            s->keys_len = 0;
+            if (!session_bootstrap(s))
+            {
+                s->closing = true;
+                break;
+            }
+        }
+        if (s->in_pending && s->in_pos == s->in_len)
+            session_read(s);
+    } while (taken != 0 && (s->keys_len != 0 || s->in_pos < s->in_len) &&
+             s->out_len < SESSION_OUT_HIGH && !s->closing);
+
+    session_flush(s);
+    bool busy = session_busy(s);
+    current = 0;
+    return busy;
+}
+
+static void worker_activate(worker_t *w, session_t *s)
+{
+    if (s->active)
+        return;
+    s->active = true;
+    s->next_active = w->active;
+    w->active = s;
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    struct epoll_event events[SERVER_EVENTS];
+
+    while (true)
+    {
+        int n = epoll_wait(w->epfd, events, SERVER_EVENTS, w->active ? 0 : -1);
+        if (n < 0 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            return 0;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            session_t *s = events[i].data.ptr;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                session_read(s);
+            if (events[i].events & EPOLLOUT)
+                session_flush(s);
+            worker_activate(w, s);
+        }
+
+        // Run each active session once, keeping the ones still busy
+        session_t *s = w->active;
+        w->active = 0;
+        while (s)
+        {
+            session_t *next = s->next_active;
+            s->active = false;
+            if (session_run(s))
+                worker_activate(w, s);
+            else if (s->closing)
+                session_free(s);
+            s = next;
+        }
+    }
+}
+
+static int server_listen(const char *address, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1 ||
+        bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Usage: bastos-server [port [workers [address [heap size]]]]
+int main(int argc, char **argv)
+{
+    int port = argc > 1 ? atoi(argv[1]) : SERVER_PORT;
+    int worker_count = argc > 2 ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    const char *address = argc > 3 ? argv[3] : "127.0.0.1";
+    if (worker_count < 1)
+        worker_count = 1;
+    if (argc > 4)
+    {
+        // The size must fit the heap offsets of the build
+        unsigned long size = strtoul(argv[4], 0, 0);
+        heap_size = size < SESSION_HEAP_MIN ? SESSION_HEAP_MIN : size > (bsize_t) -1 ? (bsize_t) -1 : size;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    if (chdir("disk") < 0)
+        perror("disk");
+
+    int listen_fd = server_listen(address, port);
+    if (listen_fd < 0)
+    {
+        perror("listen");
+        return 1;
+    }
+
+    worker_t *workers = calloc(worker_count, sizeof(worker_t));
+    for (int i = 0; i < worker_count; i++)
+    {
+        workers[i].epfd = epoll_create1(0);
+        if (workers[i].epfd < 0 || pthread_create(&workers[i].thread, 0, worker_main, &workers[i]) != 0)
+        {
+            perror("worker");
+            return 1;
+        }
+    }
+    fprintf(stderr, "BASTOS server on %s:%d, %d workers, %lu bytes sessions\n", address, port, worker_count,
+            (unsigned long) heap_size);
+
+    for (int next = 0;; next = (next + 1) % worker_count)
+    {
+        int fd = accept4(listen_fd, 0, 0, SOCK_NONBLOCK);
+        if (fd < 0)
+        {
+            if (errno != EINTR)
+                perror("accept");
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        session_t *s = session_new(fd);
+        if (!s)
+        {
+            close(fd);
+            continue;
+        }
+
+        // The worker gets the session with the first EPOLLOUT event
+        struct epoll_event event = {0};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = s;
+        if (epoll_ctl(workers[next].epfd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            perror("epoll_ctl");
+            session_free(s);
+        }
+    }
+}
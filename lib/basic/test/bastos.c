@@ -12,7 +12,6 @@
 #include <poll.h>
 #include <signal.h>
 #include <errno.h>
-#include <dirent.h>
 
 #ifdef MINITEL
 #include "tty-minitel.h"
@@ -39,30 +38,54 @@ void term_done()
     tcsetattr(0, TCSANOW, &old);
 }
 
+// Set on Ctrl-C, loop() then ends the recording outside of the handler where
+// stdio is not safe to call
+static volatile sig_atomic_t sigint_caught;
+
 void sigint_handler(int sig_no)
 {
-    term_done();
-    sigaction(SIGINT, &old_action, NULL);
-    kill(0, SIGINT);
+    sigint_caught = 1;
 }
 
+#define KEYS_SIZE (256)
+
+// Keys read from the terminal, served one by one to os_get_key()
+static uint8_t keys_in[KEYS_SIZE];
+static size_t keys_in_pos, keys_in_len;
+static bool keys_eof; // End of input: exit once the keys are handled
+
 uint8_t hal_get_key()
 {
+    if (keys_in_pos < keys_in_len)
+        return keys_in[keys_in_pos++];
+    if (keys_eof)
+        return 0;
+
     struct pollfd input[1] = {{fd : 0, events : POLLIN}};
-    int ret = poll(input, 1, 1);
+    // Do not wait for keys while a program runs
+    int ret = poll(input, 1, bastos_running() && !bastos_inputting() ? 0 : 1);
 
+    if (ret < 0 && errno == EINTR)
+        return 0;
     if (ret < 0)
         goto err;
 
     if (ret == 0)
         return 0;
 
-    uint8_t ch = 0;
-    int n = read(0, (char *)&ch, 1);
-    if (n <= 0)
+    // Read all the keys available, a pasted program comes in one read
+    int n = read(0, keys_in, KEYS_SIZE);
+    if (n == 0)
+    {
+        keys_eof = true;
+        return 0;
+    }
+    if (n < 0)
         goto err;
 
-    return ch;
+    keys_in_pos = 1;
+    keys_in_len = n;
+    return keys_in[0];
 
 err:
     fprintf(stderr, "Error reading key\n");
@@ -70,9 +93,9 @@ err:
     exit(0);
 }
 
-int hal_print_float(float f)
+int hal_output(const char *buffer, int count)
 {
-    int n = printf("%g", f);
+    int n = fwrite(buffer, 1, count, stdout);
     fflush(stdout);
     return n;
 }
@@ -91,88 +114,166 @@ int hal_print_integer(const char *format, int32_t i)
     return n;
 }
 
-int hal_open(const char *pathname, int flags)
+static void hal_reset()
 {
-    if ((flags & O_CREAT) != 0)
-        return creat(pathname, 0644);
+}
 
-    return open(pathname, flags);
+/*
+ * Session recording and replay.
+ *
+ * The recorder logs each chunk of keys taken by bastos_send_keys(), with the
+ * interpreter step (bastos_steps()) it was taken at and the count of loops
+ * run since that step without running a line. A line of the log is either
+ * "<step> <loops> <keys in hex>", "reset" when the session restarts, or
+ * "<step> <loops>" when the recording ends.
+ *
+ * The replay sends each chunk back at the same step and loop, with a quantum
+ * cut so that the program stops exactly there. The output goes to stdout, to
+ * be compared with the one of the recorded session.
+ */
+
+#define RECORD_LINE_SIZE (2 * KEYS_SIZE + 32)
+
+typedef struct
+{
+    bool reset;
+    bool end;
+    uint32_t step;
+    uint32_t loops;
+    size_t len;
+    char keys[KEYS_SIZE];
+} record_t;
+
+static FILE *record_file;
+static FILE *replay_file;
+static record_t replay;      // Next record to replay
+static uint32_t replay_line; // Its line in the log
+static uint32_t idle_loops;  // Loops run since the step changed
+
+// Run bastos_loop(), counting the loops that run no program line
+static void session_loop(void)
+{
+    uint32_t steps = bastos_steps();
+    bastos_loop();
+    if (bastos_is_reset() || bastos_steps() != steps)
+        idle_loops = 0;
+    else
+        idle_loops++;
 }
 
-int hal_close(int fd)
+static void record_keys(const char *keys, size_t n)
 {
-    return close(fd);
+    if (!record_file || n == 0)
+        return;
+    fprintf(record_file, "%u %u ", bastos_steps(), idle_loops);
+    for (size_t i = 0; i < n; i++)
+        fprintf(record_file, "%02x", (uint8_t) keys[i]);
+    fprintf(record_file, "\n");
+    fflush(record_file);
 }
 
-int hal_write(int fd, const void *buf, int count)
+static void record_reset(void)
 {
-    return write(fd, buf, count);
+    if (record_file)
+        fprintf(record_file, "reset\n");
 }
 
-int hal_read(int fd, void *buf, int count)
+static void record_end(void)
 {
-    return read(fd, buf, count);
+    if (!record_file)
+        return;
+    if (bastos_is_reset())
+        fprintf(record_file, "0 0\n");
+    else
+        fprintf(record_file, "%u %u\n", bastos_steps(), idle_loops);
+    fclose(record_file);
+    record_file = 0;
 }
 
-void hal_cat()
+// Read the next record of the log. Without an end record, the replay ends
+// when the session waits for keys.
+static void replay_next(void)
 {
-    off_t total = 0;
-    hal_print_string("\r\nDrive: A\r\n\r\n");
-    struct dirent **entry;
-    int n = scandir(".", &entry, NULL, NULL);
-    while (n--)
+    char line[RECORD_LINE_SIZE];
+    memset(&replay, 0, sizeof(replay));
+    replay_line++;
+    if (!fgets(line, sizeof(line), replay_file))
     {
-        if (strcmp(".", entry[n]->d_name) && strcmp("..", entry[n]->d_name))
-        {
-            char *path = entry[n]->d_name;
-            struct stat st;
-            if (stat(path, &st) == -1)
-                continue;
-            total += st.st_blocks * 512; // st_blocks is in 512-byte blocks
-
-            uint8_t len = strlen(path);
-            hal_print_string(path);
-            for (int i = 16 - len; i > 0; i--)
-                hal_print_string(" ");
-            hal_print_integer("%ju\r\n", st.st_size);
-        }
-        free(entry[n]);
+        replay.end = true;
+        replay.step = UINT32_MAX;
+        replay.loops = 1;
+        return;
     }
-    free(entry);
-    hal_print_integer("\r\n%3uK free\r\n\r\nReady\r\n", (524288 - total) / 1024);
-    fflush(stdout);
-}
 
-int hal_erase(const char *pathname)
-{
-    return unlink(pathname);
+    if (!strcmp(line, "reset\n"))
+    {
+        replay.reset = true;
+        return;
+    }
+
+    char *keys;
+    replay.step = strtoul(line, &keys, 10);
+    replay.loops = strtoul(keys, &keys, 10);
+    while (*keys == ' ')
+        keys++;
+    unsigned int key;
+    while (replay.len < KEYS_SIZE && sscanf(keys, "%2x", &key) == 1)
+    {
+        replay.keys[replay.len++] = key;
+        keys += 2;
+    }
+    replay.end = replay.len == 0;
 }
 
-static void hal_reset()
+static void replay_diverged(const char *why)
 {
+    fflush(stdout);
+    fprintf(stderr, "Replay diverged at line %u of the log, step %u: %s\n",
+            replay_line, bastos_steps(), why);
+    exit(1);
 }
 
-void hal_speed(uint8_t fn)
+// Loop of a replayed session, sending the keys of a record when the session
+// reaches its step and loop
+static void replay_loop(void)
 {
-    if (fn == TOKEN_KEYWORD_FAST || fn == TOKEN_KEYWORD_SLOW)
+    uint32_t steps = bastos_steps();
+    bool waiting = !bastos_running() || bastos_inputting();
+
+    if (replay.end && (steps == replay.step || (waiting && replay.step == UINT32_MAX)) &&
+        idle_loops >= replay.loops)
     {
-#ifdef MINITEL
-        hal_print_string(fn == TOKEN_KEYWORD_FAST ? P_PRISE_4800 : P_PRISE_1200);
-#endif
+        bastos_done();
+        exit(0);
     }
-}
-
-int hal_wifi(int func)
-{
-    if (func == TOKEN_KEYWORD_LIST)
+    if (!replay.reset && replay.step != UINT32_MAX)
     {
-        hal_print_string("Connected via host LAN\r\n");
-        return 1;
+        if (replay.step < steps || (replay.step == steps && replay.loops < idle_loops))
+            replay_diverged("record passed");
+        if (replay.step > steps && waiting)
+            replay_diverged("program not running");
+        if (!replay.end && replay.step == steps && replay.loops == idle_loops)
+        {
+            if (bastos_send_keys(replay.keys, replay.len, true) != replay.len)
+                replay_diverged("keys not taken");
+            replay_next();
+        }
     }
-    else
+
+    // Stop running lines at the step of the next record
+    uint32_t lines = BASTOS_QUANTUM_LINES;
+    if (!replay.reset && replay.step - bastos_steps() < lines)
+        lines = replay.step - bastos_steps();
+    bastos_set_quantum(lines, 0);
+
+    session_loop();
+    if (bastos_is_reset())
     {
-        hal_print_string("Not implemented WiFi command\r\n");
-        return -1;
+        if (!replay.reset)
+            replay_diverged("unexpected reset");
+        replay_next();
+        bastos_done();
+        hal_reset();
     }
 }
 
@@ -181,29 +282,94 @@ void setup()
     os_bootstrap();
 }
 
+// Keys translated by os_get_key() and not taken by the interpreter yet
+static char keys[KEYS_SIZE];
+static size_t keys_len;
+
 void loop(void)
 {
+    if (sigint_caught)
+    {
+        sigint_caught = 0;
+        record_end();
+        term_done();
+        sigaction(SIGINT, &old_action, NULL);
+        kill(0, SIGINT);
+    }
+
     // if connected, loop_connected();
-    char key = os_get_key();
-    bastos_send_keys((char *)&key, key != 0 ? 1 : 0, true);
-    bastos_loop();
+    while (keys_len < KEYS_SIZE)
+    {
+        char key = os_get_key();
+        if (key == 0)
+            break;
+        keys[keys_len++] = key;
+    }
+
+    size_t n = bastos_send_keys(keys, keys_len, true);
+    record_keys(keys, n);
+    memmove(keys, keys + n, keys_len - n);
+    keys_len -= n;
+
+    // Lines left in the interpreter are handled by a loop that does not run
+    // a program
+    bool idle = !bastos_running() || bastos_inputting();
+    session_loop();
     if (bastos_is_reset())
     {
+        record_reset();
         bastos_done();
         hal_reset();
+        keys_len = 0;
+    }
+    else if (keys_eof && keys_len == 0 && idle && (!bastos_running() || bastos_inputting()))
+    {
+        record_end();
+        term_done();
+        exit(0);
     }
 }
 
-int main()
+int main(int argc, char **argv)
 {
+    for (int arg = 1; arg < argc; arg += 2)
+    {
+        FILE **file = !strcmp(argv[arg], "-r") ? &record_file :
+                      !strcmp(argv[arg], "-p") ? &replay_file : 0;
+        if (file == 0 || arg + 1 >= argc)
+        {
+            fprintf(stderr, "Usage: %s [-r record.log | -p replay.log]\n", argv[0]);
+            return 1;
+        }
+        *file = fopen(argv[arg + 1], file == &record_file ? "w" : "r");
+        if (*file == 0)
+        {
+            perror(argv[arg + 1]);
+            return 1;
+        }
+    }
+
+    chdir("disk");
+
+    if (replay_file)
+    {
+        replay_next();
+        while (true)
+        {
+            setup();
+            while (!bastos_is_reset())
+            {
+                replay_loop();
+            }
+        }
+    }
+
     struct sigaction action = {0};
     action.sa_handler = &sigint_handler;
     sigaction(SIGINT, &action, &old_action);
 
     term_init();
 
-    chdir("disk");
-
     while (true)
     {
         setup();
@@ -0,0 +1,300 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bio.h"
+#include "os.h"
+#include "hal-null.h"
+
+/*
+ * Headless benchmark runner.
+ *
+ * Runs synthetic workloads and .bst programs with a null terminal: no keys,
+ * output counted and dropped. Prints one JSON object per run on stdout.
+ *
+ * Usage: bastos-bench [-s seconds] [-l lines] [-p profile.csv] [file.bst...]
+ *
+ * With -p, the program lines of each run are profiled and appended to the
+ * file as name,line,hits,us,bytes rows.
+ */
+
+#define BENCH_SECONDS (2.0)          // Default time limit of a run
+#define BENCH_LINES (100000000)      // Default program line limit of a run
+#define BENCH_PROFILE_LINES (1024)   // Most lines dumped by -p
+#define BENCH_ERROR "Error "             // Start of an error report...
+#define BENCH_ERROR_LEN (6)              // ...and its length
+
+typedef struct
+{
+    const char *name;
+    const char *prog;    // Program lines, '\n' terminated
+    const char *command; // Immediate command to time
+    int repeat;          // Number of times the command is run
+} workload_t;
+
+static const workload_t workloads[] = {
+    {
+        "for-next",
+        "10 LET S=0\n"
+        "20 FOR I=1 TO 200000\n"
+        "30 LET S=S+I*2-I/4\n"
+        "40 NEXT I\n",
+        "RUN\n", 1
+    },
+    {
+        "int-loop",
+        "10 LET S#=0\n"
+        "20 FOR I#=1 TO 200000\n"
+        "30 LET S#=S#+I#*2-I#%4\n"
+        "40 NEXT I#\n",
+        "RUN\n", 1
+    },
+    {
+        "string-concat",
+        "10 FOR I=1 TO 20000\n"
+        "20 LET A$=\">\"\n"
+        "30 FOR J=1 TO 10\n"
+        "40 LET A$=A$+\"AB\"+CHR$(65+J)\n"
+        "50 NEXT J\n"
+        "60 NEXT I\n",
+        "RUN\n", 1
+    },
+    {
+        "array-fill",
+        "10 DIM A(1000)\n"
+        "20 FOR K=1 TO 100\n"
+        "30 FOR I=1 TO 1000\n"
+        "40 LET A(I)=I*K\n"
+        "50 NEXT I\n"
+        "60 NEXT K\n",
+        "RUN\n", 1
+    },
+    {
+        "gosub",
+        "10 FOR I=1 TO 50000\n"
+        "20 GOSUB 100\n"
+        "30 NEXT I\n"
+        "40 STOP\n"
+        "100 LET N=N+1\n"
+        "110 RETURN\n",
+        "RUN\n", 1
+    },
+    {
+        "list",
+        "10 REM BASTOS LIST BENCHMARK\n"
+        "20 FOR I=1 TO 10 STEP 2\n"
+        "30 IF I>5 THEN PRINT \"BIG\";I\n"
+        "40 LET A$=\"HELLO WORLD \"+STR$ I\n"
+        "50 GOSUB 100\n"
+        "60 NEXT I\n"
+        "70 STOP\n"
+        "100 PRINT A$;\" \";LEN(A$)\n"
+        "110 RETURN\n",
+        "LIST\n", 2000
+    },
+    {
+        "screen-paint",
+        "10 FOR F=1 TO 200\n"
+        "20 PRINT CLS;INK 7;PAPER 0;AT 1,1;\"======================================\";\n"
+        "30 FOR R=2 TO 20\n"
+        "40 PRINT AT R,1;INK 3;\"|\";INK 3;\"                                    \";INK 3;\"|\";\n"
+        "50 NEXT R\n"
+        "60 FOR M=1 TO 5\n"
+        "70 PRINT AT 4+M*2,10;INK 6;PAPER 0;\"ITEM \";M;AT 4+M*2,18;INK 7;\"..........\";\n"
+        "80 NEXT M\n"
+        "90 NEXT F\n",
+        "RUN\n", 1
+    },
+    {
+        "screen-refresh",
+        "5 SCREEN 2\n"
+        "10 FOR F=1 TO 200\n"
+        "20 PRINT CLS;INK 7;PAPER 0;AT 1,1;\"======================================\";\n"
+        "30 FOR R=2 TO 20\n"
+        "40 PRINT AT R,1;INK 3;\"|\";INK 3;\"                                    \";INK 3;\"|\";\n"
+        "50 NEXT R\n"
+        "60 FOR M=1 TO 5\n"
+        "70 PRINT AT 4+M*2,10;INK 6;PAPER 0;\"ITEM \";M;AT 4+M*2,18;INK 7;\"..........\";\n"
+        "80 NEXT M\n"
+        "85 PRINT AT 22,1;\"FRAME \";F;\n"
+        "87 REFRESH\n"
+        "90 NEXT F\n",
+        "RUN\n", 1
+    },
+};
+
+/* Output, counted */
+
+static uint64_t output_bytes;
+static uint64_t output_writes;
+static uint32_t errors; // "Error n" reports seen in the output
+static char error_tail[BENCH_ERROR_LEN - 1]; // Last bytes written, where a
+static int error_tail_len;                   // report may start
+static FILE *profile_file; // -p output, or 0
+
+void null_output(const char *data, int count)
+{
+    output_bytes += count;
+    output_writes++;
+
+    // A report split between two writes starts in the tail of the previous
+    // one: look for it with the start of this one
+    char joined[2 * (BENCH_ERROR_LEN - 1)];
+    int head = count < BENCH_ERROR_LEN - 1 ? count : BENCH_ERROR_LEN - 1;
+    memcpy(joined, error_tail, error_tail_len);
+    memcpy(joined + error_tail_len, data, head);
+    if (memmem(joined, error_tail_len + head, BENCH_ERROR, BENCH_ERROR_LEN))
+        errors++;
+
+    for (const char *p = data; (p = memmem(p, data + count - p, BENCH_ERROR, BENCH_ERROR_LEN)); p++)
+        errors++;
+
+    // Keep the last bytes written for the next write
+    int keep = error_tail_len + count < BENCH_ERROR_LEN - 1 ? error_tail_len + count : BENCH_ERROR_LEN - 1;
+    int from_data = count < keep ? count : keep;
+    memmove(error_tail, error_tail + error_tail_len - (keep - from_data), keep - from_data);
+    memcpy(error_tail + keep - from_data, data + count - from_data, from_data);
+    error_tail_len = keep;
+}
+
+/* Runs */
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Run a command until the program stops, waits for input or hits a limit
+static const char *bench_command(const char *command, double seconds, uint32_t lines, double start)
+{
+    bastos_stats_t stats;
+
+    if (!null_send(command))
+    {
+        bastos_stop();
+        return "keys";
+    }
+    while (bastos_running())
+    {
+        if (bastos_inputting())
+        {
+            bastos_stop();
+            return "input";
+        }
+        bastos_stats(&stats, false);
+        if (stats.lines >= lines || bench_now() - start >= seconds)
+        {
+            bastos_stop();
+            return "limit";
+        }
+        bastos_loop();
+    }
+    return "done";
+}
+
+static void bench_run(const char *name, const char *prog, const char *file,
+                      const char *command, int repeat, double seconds, uint32_t lines)
+{
+    errors = 0;
+    error_tail_len = 0;
+    bastos_init();
+    bastos_set_quantum(BASTOS_QUANTUM_LINES, 0);
+
+    const char *status = "done";
+    if (file && bastos_load(file) != BERROR_NONE)
+        status = "load-error";
+    if (prog && !null_send(prog))
+        status = "keys";
+    if (errors != 0)
+        status = "prog-error";
+
+    bastos_stats_t stats;
+    bastos_stats(&stats, true);
+    output_bytes = output_writes = errors = 0;
+    if (profile_file)
+        bastos_profile(true);
+
+    double start = bench_now();
+    for (int i = 0; i < repeat && !strcmp(status, "done"); i++)
+        status = bench_command(command, seconds, lines, start);
+    double elapsed = bench_now() - start;
+    if (errors != 0 && !strcmp(status, "done"))
+        status = "error";
+
+    bastos_stats(&stats, false);
+    printf("{\"name\": \"%s\", \"status\": \"%s\", \"seconds\": %.6f, "
+           "\"lines\": %u, \"lines_per_sec\": %.0f, \"commands\": %d, "
+           "\"heap_size\": %u, \"heap_peak\": %u, \"heap_end\": %u, "
+           "\"strings_peak\": %u, \"vars_peak\": %u, \"string_allocs\": %u, "
+           "\"string_bytes\": %u, \"var_allocs\": %u, \"var_unsets\": %u, "
+           "\"moves\": %u, \"bytes_moved\": %u, "
+           "\"output_bytes\": %llu, \"output_writes\": %llu, \"errors\": %u}\n",
+           name, status, elapsed,
+           stats.lines, elapsed > 0 ? stats.lines / elapsed : 0, repeat,
+           stats.heap_size, stats.heap_size - stats.heap_free_min, stats.heap_size - stats.heap_free,
+           stats.strings_peak, stats.vars_peak, stats.string_allocs,
+           stats.string_bytes, stats.var_allocs, stats.var_unsets,
+           stats.moves, stats.bytes_moved,
+           (unsigned long long) output_bytes, (unsigned long long) output_writes, errors);
+    fflush(stdout);
+
+    if (profile_file)
+    {
+        static bastos_profile_t profile[BENCH_PROFILE_LINES];
+        uint16_t n = bastos_profile_get(profile, BENCH_PROFILE_LINES);
+        for (uint16_t i = 0; i < n; i++)
+            fprintf(profile_file, "%s,%u,%u,%u,%u\n", name, profile[i].line_no,
+                    profile[i].hits, profile[i].us, profile[i].bytes);
+        fflush(profile_file);
+    }
+
+    bastos_done();
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = BENCH_SECONDS;
+    uint32_t lines = BENCH_LINES;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (!strcmp(argv[arg], "-s"))
+            seconds = atof(argv[arg + 1]);
+        else if (!strcmp(argv[arg], "-l"))
+            lines = strtoul(argv[arg + 1], 0, 10);
+        else if (!strcmp(argv[arg], "-p"))
+        {
+            profile_file = fopen(argv[arg + 1], "a");
+            if (profile_file == 0)
+            {
+                perror(argv[arg + 1]);
+                return 1;
+            }
+        }
+        else
+            break;
+    }
+    if (arg < argc && argv[arg][0] == '-')
+    {
+        fprintf(stderr, "Usage: %s [-s seconds] [-l lines] [-p profile.csv] [file.bst...]\n", argv[0]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++)
+    {
+        const workload_t *w = &workloads[i];
+        bench_run(w->name, w->prog, 0, w->command, w->repeat, seconds, lines);
+    }
+
+    for (; arg < argc; arg++)
+        bench_run(argv[arg], 0, argv[arg], "RUN\n", 1, seconds, lines);
+
+    return 0;
+}
@@ -0,0 +1,577 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bio.h"
+#include "os.h"
+#include "hal-null.h"
+
+/*
+ * Headless regression runner.
+ *
+ * Runs small programs with a null terminal and compares their output with
+ * the expected one. Control characters are shown as ^X, CR is dropped. The
+ * input lines of a check are typed when its program asks for them. Prints one
+ * line per check and exits with 1 when one fails.
+ *
+ * Usage: bastos-check [-v] [name...]
+ *
+ * With -v, the output of each check is printed. Names select the checks run.
+ */
+
+#define CHECK_LINES (1000000)  // Program line limit of a check
+#define CHECK_OUTPUT (4096)    // Largest rendered output kept
+#define CHECK_INPUT_LINE (128) // Longest line typed for INPUT, end included
+#define CHECK_SPACES "                                        " // 40, for long lines
+
+// Saves a program of 2 KB in chkload, then leaves less than that free
+#define CHECK_BIG_PROG \
+    "10 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "20 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "30 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "40 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "50 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "60 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "70 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "80 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "90 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "100 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "110 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "120 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "130 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "140 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "150 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "160 REM" CHECK_SPACES CHECK_SPACES CHECK_SPACES "\n" \
+    "SAVE \"chkload\" PROG\n" \
+    "NEW\n"
+
+typedef struct
+{
+    const char *name;
+    const char *prog;    // Program lines, '\n' terminated
+    const char *command; // Immediate command run
+    const char *output;  // Its expected output
+    const char *input;   // Lines typed when the program inputs, if any
+} check_t;
+
+static const check_t checks[] = {
+    {
+        // 65536 moves of the variables wrap their generation around: the
+        // loop must not take the offset of I cached before them
+        "loop-vars-wrap",
+        "10 DIM Z(1)\n"
+        "20 FOR I=1 TO 2\n"
+        "30 FOR J=1 TO 65536\n"
+        "40 DIM Z(1)\n"
+        "50 NEXT J\n"
+        "60 PRINT I;\n"
+        "70 NEXT I\n"
+        "80 PRINT \"END\";I\n",
+        "RUN\n",
+        "12END3\nReady\n"
+    },
+    {
+        // Same for the array of a reference: A moves between two runs of line
+        // 40, and the number of moves goes over the wrap around
+        "array-site-wrap",
+        "10 DIM Z(1)\n"
+        "20 DIM A(2)\n"
+        "25 LET A(1)=7\n"
+        "30 FOR K=65531 TO 65536\n"
+        "40 PRINT A(1);\n"
+        "50 FOR J=1 TO K\n"
+        "60 DIM Z(1)\n"
+        "70 NEXT J\n"
+        "75 DIM W(K-65530)\n"
+        "80 DIM A(2)\n"
+        "90 LET A(1)=7\n"
+        "100 NEXT K\n",
+        "RUN\n",
+        "777777Ready\n"
+    },
+    {
+        // 8192 * 8192 * 16 cells of 4 bytes: the size wraps around to 0 on 32
+        // bits, the array must still be too large for the memory
+        "dim-overflow",
+        "",
+        "DIM A(8192,8192,16)\n",
+        "Error 3\n"
+    },
+    {
+        // The paper of alphanumeric characters shows from a delimiter space:
+        // the 2 repainted is sent after one in its own cell, then BS
+        "screen-paper",
+        "10 SCREEN 2\n"
+        "20 PRINT AT 5,1;PAPER 4;\" ITEM 1  \";\n"
+        "30 REFRESH\n"
+        "40 PRINT AT 5,1;PAPER 4;\" ITEM 2  \";\n"
+        "50 REFRESH\n",
+        "RUN\n",
+        "^L^_EA^[T ITEM 1  ^_EG^[T ^H2^_EJ^[T ^HReady^_FA"
+    },
+    {
+        // '%' is the modulo operator whatever follows it, the integer
+        // suffix is '#'
+        "modulo-operand",
+        "10 LET A=7\n"
+        "20 LET B=3\n"
+        "30 PRINT A%-2;A%(B);A% 3;A%(2+1)\n"
+        "40 DIM A#(3)\n"
+        "50 LET A#(3)=5\n"
+        "60 PRINT A#(B);A#(B)%-2;A%(B)\n",
+        "RUN\n",
+        "1111\n511\nReady\n"
+    },
+    {
+        // Integral constants are exact in integer variables, which wrap
+        // around; INPUT stores the same value
+        "integer-literals",
+        "10 LET B#=123456789\n"
+        "20 LET C#=2147483647\n"
+        "30 PRINT B#;\" \";C#\n"
+        "40 LET D#=C#+1\n"
+        "50 PRINT D#;\" \";D#-1;\" \";-2147483648+B#\n"
+        "60 LET N#=-17\n"
+        "70 PRINT B#%1000;\" \";N#%5;\" \";N#%-5;\" \";B#*3%7\n"
+        "80 INPUT E#\n"
+        "90 PRINT E#-B#;\" \";E#\n"
+        "100 LIST 20\n",
+        "RUN\n",
+        "123456789 2147483647\n"
+        "-2147483648 2147483647 -2024026859\n"
+        "789 -2 -2 3\n"
+        "0 123456789\n"
+        "  20 LET c#=2147483647\n"
+        "  30 PRINT b#;\" \";c#\n"
+        "  40 LET d#=c#+1\n"
+        "  50 PRINT d#;\" \";d#-1;\" \";-2.1474836e+09+b#\n"
+        "  60 LET n#=-17\n"
+        "  70 PRINT b#%1000;\" \";n#%5;\" \";n#%-5;\" \";b#*3%7\n"
+        "  80 INPUT e#\n"
+        "  90 PRINT e#-b#;\" \";e#\n"
+        " 100>LIST 20\n"
+        "Ready\n",
+        "123456789\n"
+    },
+    {
+        // Integer variables truncate and saturate what they store, their
+        // operators stay integer but '/', loops step in integers, and a
+        // modulo by 0 is a range error that ends PRINT without a new line
+        "integer-variables",
+        "10 LET A#=7.9\n"
+        "20 LET B#=-7.9\n"
+        "30 LET C#=1E20\n"
+        "40 LET D#=-1E20\n"
+        "50 PRINT A#;\" \";B#;\" \";C#;\" \";D#\n"
+        "60 PRINT A#/2;\" \";A#*B#;\" \";A#-B#*2;\" \";A#&3;\" \";A#|8\n"
+        "70 PRINT A#>B#;A#=7;\" \";STR$(A#*1000000)\n"
+        "80 LET S#=0\n"
+        "90 FOR I#=1 TO 10 STEP 3\n"
+        "100 LET S#=S#+I#\n"
+        "110 NEXT I#\n"
+        "120 PRINT S#;\" \";I#\n"
+        "130 DIM T#(3)\n"
+        "140 LET T#(2)=A#*B#+0.5\n"
+        "150 PRINT T#(2);\" \";T#(1)\n"
+        "160 PRINT A#;A#%0\n",
+        "RUN\n",
+        "7 -7 2147483647 -2147483648\n3.5 -49 21 3 15\n11 7000000\n22 13\n-48 0\n7On line 160: Ready\n"
+    },
+    {
+        // Constant expressions and terminal codes are folded when a line is
+        // stored, and again after LOAD: LIST still shows their source, and
+        // a folded integral number keeps the float kind
+        "fold-lines",
+        "10 LET A=2*PI/360\n"
+        "20 LET A#=2147483647\n"
+        "30 PRINT AT 2,3;INK 4;\"X\";INK 7;A*180;\" \";-2*3+(1+1)\n"
+        "40 PRINT A#+2*1;\" \";A#+1\n"
+        "50 GOTO 10*6\n"
+        "55 PRINT \"SKIPPED\"\n"
+        "60 PRINT CHR$ (64+1);LEN (\"AB\"+\"C\")\n",
+        "SAVE \"chkfold\" PROG\n"
+        "NEW\n"
+        "LOAD \"chkfold\" PROG\n"
+        "ERASE \"chkfold\"\n"
+        "LIST\n"
+        "RUN\n",
+        "  10 LET a=2*PI/360\n"
+        "  20 LET a#=2147483647\n"
+        "  30 PRINT AT 2,3;INK 4;\"X\";INK 7;a*180;\" \";-2*3+(1+1)\n"
+        "  40 PRINT a#+2*1;\" \";a#+1\n"
+        "  50 GOTO 10*6\n"
+        "  55 PRINT \"SKIPPED\"\n"
+        "  60 PRINT CHR$(64+1);LEN(\"AB\"+\"C\")\n"
+        "^_BC^[DX^[G3.1415927 -4\n"
+        "2.1474836e+09 -2147483648\n"
+        "A3\n"
+        "Ready\n"
+    },
+    {
+        // The loop stack takes 16 nested loops with 16-bit heap offsets too
+        "nested-loops",
+        "10 FOR A=1 TO 1\n"
+        "11 FOR B=1 TO 1\n"
+        "12 FOR C=1 TO 1\n"
+        "13 FOR D=1 TO 1\n"
+        "14 FOR E=1 TO 1\n"
+        "15 FOR F=1 TO 1\n"
+        "16 FOR G=1 TO 1\n"
+        "17 FOR H=1 TO 1\n"
+        "18 FOR I=1 TO 1\n"
+        "19 FOR J=1 TO 1\n"
+        "20 FOR K=1 TO 1\n"
+        "21 FOR L=1 TO 1\n"
+        "22 FOR M=1 TO 1\n"
+        "23 FOR N=1 TO 1\n"
+        "24 FOR O=1 TO 1\n"
+        "25 FOR P=1 TO 1\n"
+        "100 PRINT \"IN\"\n"
+        "200 NEXT P\n"
+        "201 NEXT O\n"
+        "202 NEXT N\n"
+        "203 NEXT M\n"
+        "204 NEXT L\n"
+        "205 NEXT K\n"
+        "206 NEXT J\n"
+        "207 NEXT I\n"
+        "208 NEXT H\n"
+        "209 NEXT G\n"
+        "210 NEXT F\n"
+        "211 NEXT E\n"
+        "212 NEXT D\n"
+        "213 NEXT C\n"
+        "214 NEXT B\n"
+        "215 NEXT A\n"
+        "300 PRINT P\n",
+        "RUN\n",
+        "IN\n2\nReady\n"
+    },
+    {
+        // Lines the VM compiles, mixed with lines left to the evaluator:
+        // bastos-check-eval runs them with the evaluator only
+        "vm-lines",
+        "10 LET S=0\n"
+        "20 FOR I=10 TO 1 STEP -3\n"
+        "30 LET S=S+I*2-I/4\n"
+        "40 IF I>5 AND I<>7 THEN GOSUB 200\n"
+        "50 NEXT I\n"
+        "60 PRINT S;INT(-S/3);ABS(-2.5);SGN(-S);SQR(16)\n"
+        "70 LET N#=7\n"
+        "80 LET N#=N#*3%5+N#/2\n"
+        "90 PRINT N#;-3 OR 0;1<2;NOT 0;\"A\"<\"B\"\n"
+        "100 LET A$=\"X\"\n"
+        "110 IF S>20 THEN GOTO 130\n"
+        "120 LET A$=\"Y\"\n"
+        "130 PRINT A$;I\n"
+        "140 GOTO 300\n"
+        "200 PRINT \"G\";I;\n"
+        "210 RETURN\n"
+        "300 PRINT \"END\"\n",
+        "RUN\n",
+        "G1038.5-122.5-14\n41111\nX-2\nEND\nReady\n"
+    },
+    {
+        // A program that does not fit is not loaded: the one that loads it
+        // stays, and stops on the error
+        "load-prog-running",
+        CHECK_BIG_PROG
+        "10 DIM A(3270)\n"
+        "20 LOAD \"chkload\" PROG\n"
+        "30 PRINT \"OLD\"\n",
+        "RUN\n",
+        "On line 20: Ready\n"
+    },
+    {
+        // Same from a command: the current program stays
+        "load-prog-room",
+        CHECK_BIG_PROG
+        "10 PRINT \"OLD\"\n"
+        "DIM A(3270)\n",
+        "LOAD \"chkload\" PROG\n"
+        "LIST\n"
+        "ERASE \"chkload\"\n",
+        "Error 3\n  10 PRINT \"OLD\"\n"
+    },
+    {
+        // MAT fills, adds, subtracts, scales and copies whole number arrays,
+        // SUM, MIN, MAX and FIND read them back
+        "mat-numbers",
+        "10 DIM A(2,3)\n"
+        "20 DIM B(2,3)\n"
+        "30 DIM C(2,3)\n"
+        "40 MAT A=(1.5)\n"
+        "50 LET B(1,2)=4\n"
+        "60 LET B(2,3)=-2\n"
+        "70 MAT C=A+B\n"
+        "80 PRINT SUM C;\" \";MIN C;\" \";MAX C;\" \";FIND C,5.5\n"
+        "90 MAT C=B-A\n"
+        "100 MAT C=(2)*C\n"
+        "110 PRINT C(1,1);\" \";C(1,2);\" \";C(2,3);\" \";SUM C\n"
+        "120 MAT B=C\n"
+        "130 PRINT FIND B,-7;\" \";FIND B,9;\" \";B(2,3)\n",
+        "RUN\n",
+        "11 -0.5 5.5 2\n-3 5 -7 -14\n6 0 -7\nReady\n"
+    },
+    {
+        // Same on integer arrays, whose cells wrap around
+        "mat-integers",
+        "10 DIM N#(4)\n"
+        "20 DIM M#(4)\n"
+        "30 MAT N#=(2147483647)\n"
+        "40 MAT M#=N#+N#\n"
+        "50 PRINT M#(1);\" \";SUM M#\n"
+        "60 LET M#(3)=5\n"
+        "70 MAT N#=M#-N#\n"
+        "80 PRINT N#(1);\" \";N#(3);\" \";MIN N#;\" \";MAX N#;\" \";FIND N#,N#(3)\n"
+        "90 MAT M#=(3)*N#\n"
+        "100 PRINT M#(2);\" \";M#(3)\n",
+        "RUN\n",
+        "-2 -8\n2147483647 -2147483642 -2147483642 2147483647 3\n2147483645 -2147483630\nReady\n"
+    },
+    {
+        // String arrays are filled, copied and searched: a cell holds a
+        // string as LET stores it, padded with spaces
+        "mat-strings",
+        "10 DIM S$(3,4)\n"
+        "20 DIM T$(3,4)\n"
+        "30 MAT S$=(\"AB\")\n"
+        "40 LET S$(2)=\"XYZ\"\n"
+        "50 MAT T$=S$\n"
+        "60 PRINT T$(1);\"|\";T$(2);\"|\";T$(3);\"|\"\n"
+        "70 PRINT FIND T$,\"XYZ\";FIND T$,\"AB\";FIND T$,\"Q\"\n",
+        "RUN\n",
+        "AB |XYZ|AB |\n210\nReady\n"
+    },
+    {
+        // Arrays of other dimensions, or that do not exist, are a range
+        // error; arrays of another type do not parse
+        "mat-range",
+        "",
+        "DIM A(3)\n"
+        "DIM B(4)\n"
+        "MAT A=B\n"
+        "MAT A=C+A\n"
+        "PRINT SUM Q\n"
+        "MAT A=B#\n"
+        "DIM B(3)\n"
+        "MAT A=B\n"
+        "PRINT SUM A\n",
+        "Error 5\nError 5\nError 5\nError 1\n0\n"
+    },
+    {
+        // SAVE and LOAD take the variables or the program alone: loading
+        // one section keeps the other
+        "save-load-sections",
+        "10 PRINT A;B$;C#;D(2)\n"
+        "LET A=1.5\n"
+        "LET B$=\"HI\"\n"
+        "LET C#=-3\n"
+        "DIM D(3)\n"
+        "LET D(2)=9\n"
+        "SAVE \"chkvars\" VARS\n"
+        "SAVE \"chkprog\" PROG\n"
+        "NEW\n",
+        "LOAD \"chkvars\" VARS\n"
+        "LIST\n"
+        "PRINT A;B$;C#;D(2)\n"
+        "LET A=2\n"
+        "LOAD \"chkprog\" PROG\n"
+        "LIST\n"
+        "PRINT A\n"
+        "LOAD \"chkprog\" VARS\n"
+        "ERASE \"chkvars\"\n"
+        "ERASE \"chkprog\"\n"
+        "GOTO 10\n",
+        "1.5HI-39\n  10 PRINT a;b$;c#;d(2)\n2\nError 4\n2HI-39\nReady\n"
+    },
+    {
+        // A program restores its variables and keeps running
+        "load-vars-running",
+        "10 LET A=1.5\n"
+        "20 SAVE \"chkvars\" VARS\n"
+        "30 LET A=0\n"
+        "40 LOAD \"chkvars\" VARS\n"
+        "50 ERASE \"chkvars\"\n"
+        "60 PRINT A\n",
+        "RUN\n",
+        "1.5\nReady\n"
+    },
+    {
+        // A file of the first layout, written by main(), loads both ways
+        "load-legacy",
+        "",
+        "LOAD \"chklegacy\"\n"
+        "LIST\n"
+        "PRINT A;B$\n"
+        "NEW\n"
+        "LOAD \"chklegacy\" VARS\n"
+        "LIST\n"
+        "PRINT A;B$\n",
+        "  10 PRINT a;\" \";b$\n2.5OK\n2.5OK\n"
+    },
+    {
+        // Videotex output: runs of a character become REP, but not up to the
+        // last column; attributes that change nothing or are reset before a
+        // character are dropped, and cursor positions become moves
+        "videotex-stream",
+        "10 CLS\n"
+        "20 PRINT \"ABBBBBBBBC\";\n"
+        "30 PRINT INK 4;INK 4;\"X\";INK 4;\"Y\";INK 7;\n"
+        "40 PRINT AT 1,20;\"Z\";AT 1,23;\"W\";AT 2,1;\"V\";AT 1,1;\"U\";\n"
+        "50 PRINT AT 3,35;\"--------\";\n",
+        "RUN\n",
+        "^LAB^RGC^[DXY^_ATZ^I^IW\nV^^U^_Cc-^RD---Ready\n"
+    },
+    {
+        // Keys past the longest line are dropped, the end of the line must
+        // still be taken by the ring of the 16-bit build
+        "long-line",
+        "",
+        "PRINT 1" CHECK_SPACES CHECK_SPACES CHECK_SPACES CHECK_SPACES "2\n",
+        "1\n"
+    },
+};
+
+// A file of the first layout, as a 16-bit heap saved it: the size of the
+// program, the lines of 10 PRINT A;" ";B$, the size of the variables, then
+// B$="OK" and A=2.5 as raw 16-bit variables
+static const uint8_t check_legacy[] = {
+    0x14, 0x00,
+    0x0a, 0x00, 0x0c, 0x00, 0x9b, 0x10, 0x41, 0x00, 0x3b, 0x20, 0x20, 0x00,
+    0x3b, 0x11, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x18, 0x00,
+    0x11, 0x00, 0x05, 0x00, 0x4f, 0x4b, 0x00, 0x00, 0x00, 0x11, 0x42, 0x00,
+    0x10, 0x00, 0x04, 0x00, 0x00, 0x00, 0x20, 0x40, 0x10, 0x41, 0x00, 0x00,
+};
+
+/* Output, rendered */
+
+static char output[CHECK_OUTPUT];
+static size_t output_len;
+
+void null_output(const char *data, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t c = data[i];
+        char buffer[8];
+        if (c == '\r')
+            continue;
+        else if (c == '\n' || (c >= 0x20 && c < 0x7f))
+            snprintf(buffer, sizeof(buffer), "%c", c);
+        else if (c < 0x20 || c == 0x7f)
+            snprintf(buffer, sizeof(buffer), "^%c", c ^ 0x40);
+        else
+            snprintf(buffer, sizeof(buffer), "\\x%02x", c);
+        size_t n = strlen(buffer);
+        if (output_len + n < CHECK_OUTPUT)
+        {
+            memcpy(output + output_len, buffer, n);
+            output_len += n;
+        }
+    }
+    output[output_len] = 0;
+}
+
+/* Checks */
+
+// Run a check, return true when its output is the expected one
+static bool check_run(const check_t *c, bool verbose)
+{
+    bastos_init();
+    bastos_set_quantum(BASTOS_QUANTUM_LINES, 0);
+    const char *status = "done";
+    if (!null_send(c->prog))
+        status = "keys";
+
+    output_len = 0;
+    output[0] = 0;
+    if (!null_send(c->command))
+        status = "keys";
+    bastos_stats_t stats;
+    const char *input = c->input ? c->input : "";
+    while (bastos_running())
+    {
+        if (bastos_inputting())
+        {
+            // Type the next input line, one at a time as the program asks
+            const char *end = strchr(input, '\n');
+            char line[CHECK_INPUT_LINE];
+            if (!end || end - input >= (int) sizeof(line) - 1)
+            {
+                status = "input";
+                break;
+            }
+            memcpy(line, input, end - input + 1);
+            line[end - input + 1] = 0;
+            input = end + 1;
+            if (!null_send(line))
+            {
+                status = "keys";
+                break;
+            }
+            continue;
+        }
+        bastos_stats(&stats, false);
+        if (stats.lines >= CHECK_LINES)
+        {
+            status = "limit";
+            break;
+        }
+        bastos_loop();
+    }
+    bastos_stop();
+    bastos_loop();
+
+    bool ok = !strcmp(status, "done") && !strcmp(output, c->output);
+    printf("%s %s (%s)\n", ok ? "ok  " : "FAIL", c->name, status);
+    if (!ok || verbose)
+    {
+        printf("--- expected\n%s\n--- output\n%s\n---\n", c->output, output);
+    }
+    fflush(stdout);
+    bastos_done();
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = false;
+    int arg = 1;
+    if (arg < argc && !strcmp(argv[arg], "-v"))
+    {
+        verbose = true;
+        arg++;
+    }
+    if (arg < argc && argv[arg][0] == '-')
+    {
+        fprintf(stderr, "Usage: %s [-v] [name...]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *legacy = fopen("chklegacy", "wb");
+    if (!legacy || fwrite(check_legacy, sizeof(check_legacy), 1, legacy) != 1)
+    {
+        perror("chklegacy");
+        return 1;
+    }
+    fclose(legacy);
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++)
+    {
+        bool selected = arg == argc;
+        for (int j = arg; j < argc && !selected; j++)
+            selected = !strcmp(argv[j], checks[i].name);
+        if (selected && !check_run(&checks[i], verbose))
+            failed++;
+    }
+    remove("chklegacy");
+    if (failed)
+        printf("%d check(s) failed\n", failed);
+    return failed ? 1 : 0;
+}
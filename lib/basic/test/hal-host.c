@@ -0,0 +1,107 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+
+#ifdef MINITEL
+#include "tty-minitel.h"
+#endif
+
+#include "bio.h"
+#include "os.h"
+
+/* Host HAL shared by the terminal and the server: files, time... */
+
+uint32_t hal_micros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int hal_open(const char *pathname, int flags)
+{
+    if ((flags & O_CREAT) != 0)
+        return creat(pathname, 0644);
+
+    return open(pathname, flags);
+}
+
+int hal_close(int fd)
+{
+    return close(fd);
+}
+
+int hal_write(int fd, const void *buf, int count)
+{
+    return write(fd, buf, count);
+}
+
+int hal_read(int fd, void *buf, int count)
+{
+    return read(fd, buf, count);
+}
+
+void hal_cat()
+{
+    off_t total = 0;
+    hal_print_string("\r\nDrive: A\r\n\r\n");
+    struct dirent **entry;
+    int n = scandir(".", &entry, NULL, NULL);
+    while (n--)
+    {
+        if (strcmp(".", entry[n]->d_name) && strcmp("..", entry[n]->d_name))
+        {
+            char *path = entry[n]->d_name;
+            struct stat st;
+            if (stat(path, &st) == -1)
+                continue;
+            total += st.st_blocks * 512; // st_blocks is in 512-byte blocks
+
+            uint8_t len = strlen(path);
+            hal_print_string(path);
+            for (int i = 16 - len; i > 0; i--)
+                hal_print_string(" ");
+            hal_print_integer("%ju\r\n", st.st_size);
+        }
+        free(entry[n]);
+    }
+    free(entry);
+    hal_print_integer("\r\n%3uK free\r\n\r\nReady\r\n", (524288 - total) / 1024);
+}
+
+int hal_erase(const char *pathname)
+{
+    return unlink(pathname);
+}
+
+void hal_speed(uint8_t fn)
+{
+    if (fn == TOKEN_KEYWORD_FAST || fn == TOKEN_KEYWORD_SLOW)
+    {
+#ifdef MINITEL
+        hal_print_string(fn == TOKEN_KEYWORD_FAST ? P_PRISE_4800 : P_PRISE_1200);
+#endif
+    }
+}
+
+int hal_wifi(int func)
+{
+    if (func == TOKEN_KEYWORD_LIST)
+    {
+        hal_print_string("Connected via host LAN\r\n");
+        return 1;
+    }
+    else
+    {
+        hal_print_string("Not implemented WiFi command\r\n");
+        return -1;
+    }
+}
@@ -0,0 +1,61 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "bio.h"
+#include "os.h"
+#include "hal-null.h"
+
+/* Null HAL: no keys, output given to the runner */
+
+uint8_t hal_get_key()
+{
+    return 0;
+}
+
+int hal_output(const char *buffer, int count)
+{
+    null_output(buffer, count);
+    return count;
+}
+
+int hal_print_string(const char *s)
+{
+    int n = strlen(s);
+    null_output(s, n);
+    return n;
+}
+
+int hal_print_integer(const char *format, int i)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), format, i);
+    return hal_print_string(buffer);
+}
+
+/* Keys */
+
+bool null_send(const char *text)
+{
+    // Send the text line by line and handle each one before the next: the
+    // key ring holds IO_BUFFER_SIZE - 1 keys only, and once a line starts the
+    // program, further keys would go to INKEY$ instead of the ring
+    while (*text)
+    {
+        const char *end = strchr(text, '\n');
+        size_t n = end ? end - text + 1 : strlen(text);
+        // Keys left out of the ring are sent again after a loop round, they
+        // must all be taken in a few rounds
+        for (int round = 0; n > 0; round++)
+        {
+            if (round == NULL_SEND_ROUNDS)
+                return false;
+            size_t m = bastos_send_keys(text, n, false);
+            bastos_loop();
+            text += m;
+            n -= m;
+        }
+    }
+    return true;
+}
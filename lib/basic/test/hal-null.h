@@ -0,0 +1,16 @@
+#ifndef __HAL_NULL_H__
+#define __HAL_NULL_H__
+
+/*
+ * Null terminal of the headless runners (bastos-bench, bastos-check): no
+ * keys, and the output goes to null_output(), that each runner defines.
+ */
+
+#include <stdbool.h>
+
+#define NULL_SEND_ROUNDS (16) // Loop rounds to take the keys of a line
+
+void null_output(const char *data, int count);
+bool null_send(const char *text);
+
+#endif // __HAL_NULL_H__
@@ -32,12 +32,16 @@
 
 #define TOKEN_KEYWORD           ((uint8_t) 0b10000000)
 #define TOKEN_NUMBER            ((uint8_t) 0b01000000)
+#define TOKEN_INTEGER           ((uint8_t) 0b01000001) // Integral constant, int32_t
 #define TOKEN_STRING            ((uint8_t) 0b00100000)
 #define TOKEN_VARIABLE_NUMBER   ((uint8_t) 0b00010000)
 #define TOKEN_VARIABLE_STRING   ((uint8_t) 0b00010001)
+#define TOKEN_VARIABLE_INTEGER  ((uint8_t) 0b00010010)
 #define TOKEN_ARRAY_NUMBER      ((uint8_t) 0b00011000)
 #define TOKEN_ARRAY_STRING      ((uint8_t) 0b00011001)
+#define TOKEN_ARRAY_INTEGER     ((uint8_t) 0b00011010)
 #define TOKEN_ARRAY_FLAG        ((uint8_t) 0b00001000)
+#define TOKEN_FOLD              ((uint8_t) 0b00000010)
 
 #define TOKEN_COMPARE_EQ        ((uint8_t) '=')
 #define TOKEN_COMPARE_LT        ((uint8_t) '<')
@@ -54,5 +58,7 @@ typedef struct {
 
 static int8_t tokenize(tokenizer_state_t *state, char *line);
 static char *untokenize(uint8_t *input);
+static uint8_t *token_skip(uint8_t *ptr);
+static uint8_t *token_fold_source(uint8_t *fold);
 
 #endif // __TOKEN_H__
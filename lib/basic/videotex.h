@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __VIDEOTEX_H__
+#define __VIDEOTEX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Set BASTOS_VIDEOTEX to 0 to send the Minitel output as the program writes
+// it, without the optimizer of videotex.c-static
+#ifndef BASTOS_VIDEOTEX
+#ifdef MINITEL
+#define BASTOS_VIDEOTEX 1
+#else
+#define BASTOS_VIDEOTEX 0
+#endif
+#endif
+
+// Videotex codes
+#define VIDEOTEX_BS  (0x08) // Cursor left
+#define VIDEOTEX_HT  (0x09) // Cursor right
+#define VIDEOTEX_LF  (0x0A) // Cursor down
+#define VIDEOTEX_VT  (0x0B) // Cursor up
+#define VIDEOTEX_FF  (0x0C) // Clear the page, cursor home
+#define VIDEOTEX_CR  (0x0D) // Cursor to the first column
+#define VIDEOTEX_SO  (0x0E) // Mosaic character set
+#define VIDEOTEX_SI  (0x0F) // Text character set
+#define VIDEOTEX_CON (0x11)
+#define VIDEOTEX_REP (0x12) // Repeat the last character, count + 0x40
+#define VIDEOTEX_COFF (0x14)
+#define VIDEOTEX_CAN (0x18) // Clear to the end of the row
+#define VIDEOTEX_ESC (0x1B)
+#define VIDEOTEX_RS  (0x1E) // Cursor home
+#define VIDEOTEX_US  (0x1F) // Cursor position, row + 0x40, column + 0x40
+
+#define VIDEOTEX_ROWS (24)   // Rows of the page, the status row 0 apart
+#define VIDEOTEX_COLS (40)
+#define VIDEOTEX_REP_MAX (63)
+#define VIDEOTEX_INK_DEFAULT (0x47)   // White
+#define VIDEOTEX_PAPER_DEFAULT (0x50) // Black
+#define VIDEOTEX_SEQ_SIZE (8)         // Longest escape sequence understood
+
+// Model of the Minitel screen state, built from the output
+typedef struct
+{
+    uint8_t seq[VIDEOTEX_SEQ_SIZE]; // Escape or cursor sequence being received
+    uint8_t seq_len;
+    uint8_t row;       // Cursor row, 0 being the status row...
+    uint8_t col;       // ...and column from 1, 0 if the position is not known
+    uint8_t ink;       // Ink and paper codes in effect, 0 if not known
+    uint8_t paper;
+    bool plain;        // No other attribute set since the last reset
+    uint8_t ink_set;   // Ink and paper codes to send before the next
+    uint8_t paper_set; // character, 0 if none
+    uint8_t last;      // Last character sent, 0 if something else followed...
+    uint8_t repeat;    // ...and the count of its repeats not sent yet
+} videotex_t;
+
+#if BASTOS_VIDEOTEX
+static void videotex_write(const char *data, uint16_t len);
+static void videotex_flush(void);
+static void videotex_drain(void);
+static bool videotex_sequence_done(const uint8_t *seq, uint8_t len);
+#endif
+
+#endif // __VIDEOTEX_H__
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2023 Alain Basty
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bmemory.h"
+#include "token.h"
+
+#define VM_STACK_SIZE (16)
+#define VM_SYMS_MAX (255)
+#define VM_NO_LINE (0xFFFF)
+
+// Line opcodes
+#define OP_EOL          ((uint8_t) 0)  // End of line
+#define OP_EVAL         ((uint8_t) 1)  // Run the line with the evaluator
+#define OP_IFNOT        ((uint8_t) 2)  // pop n: end of line if n == 0
+#define OP_LET          ((uint8_t) 3)  // sym; pop n
+#define OP_LET_ARRAY    ((uint8_t) 4)  // sym dims; pop n, pop indexes
+#define OP_GOTO         ((uint8_t) 5)  // line position (16 bits)
+#define OP_GOSUB        ((uint8_t) 6)  // line position (16 bits)
+#define OP_GOTO_EXPR    ((uint8_t) 7)  // pop line number
+#define OP_GOSUB_EXPR   ((uint8_t) 8)  // pop line number
+#define OP_RETURN       ((uint8_t) 9)
+#define OP_FOR          ((uint8_t) 10) // sym; pop step, limit, init
+#define OP_NEXT         ((uint8_t) 11) // sym
+#define OP_PRINT_NUMBER ((uint8_t) 12) // pop n
+#define OP_PRINT_STRING ((uint8_t) 13) // string offset in prog (bsize_t)
+#define OP_PRINT_SPACE  ((uint8_t) 14)
+#define OP_PRINT_LN     ((uint8_t) 15)
+
+// Expression opcodes
+#define OP_NUMBER       ((uint8_t) 16) // float (32 bits)
+#define OP_VAR          ((uint8_t) 17) // sym
+#define OP_ARRAY        ((uint8_t) 18) // sym dims; pop indexes
+#define OP_RND          ((uint8_t) 19)
+#define OP_NEG          ((uint8_t) 20)
+#define OP_FUNCTION     ((uint8_t) 21) // function token
+#define OP_BINARY       ((uint8_t) 22) // operator token: * / % + - & |, compare tokens
+#define OP_AND          ((uint8_t) 23)
+#define OP_OR           ((uint8_t) 24)
+#define OP_INT          ((uint8_t) 25) // integer (32 bits)
+#define OP_I2F          ((uint8_t) 26) // integer to float
+#define OP_I2F_NOS      ((uint8_t) 27) // integer to float, below the top of the stack
+#define OP_F2I          ((uint8_t) 28) // float to integer
+#define OP_BINARY_INT   ((uint8_t) 29) // operator token: * % + - & |, compare tokens
+#define OP_NEG_INT      ((uint8_t) 30)
+
+// Integer line opcodes
+#define OP_IFNOT_INT    ((uint8_t) 31) // pop i: end of line if i == 0
+#define OP_PRINT_INT    ((uint8_t) 32) // pop i
+
+// A stack cell holds a float or an integer, the compiler knows which
+typedef union
+{
+    float number;
+    int32_t integer;
+} vm_cell_t;
+
+// A symbol is a variable name referenced by the compiled program
+typedef struct
+{
+    bsize_t name; // Offset of the name in the program memory
+    bsize_t var;  // Offset of the var from vars_end, 0 if not resolved
+    bool array;
+} vm_sym_t;
+
+// Compiled program header, followed by the code offset of each line of the
+// line index, the bytecode and the symbols (in reverse order). Offsets are
+// from the header.
+typedef struct
+{
+    uint16_t sym_count;
+    uint16_t vars_gen; // Symbols are resolved for this variables generation
+    bsize_t syms;
+    bsize_t lines[0];
+} vm_code_t;
+
+static int8_t vm_prog_next();
+
+#endif // __VM_H__
@@ -68,9 +68,25 @@ uint8_t hal_get_key()
     return n > 0 ? key : 0;
 }
 
-int hal_print_float(float f)
+uint32_t hal_micros()
 {
-    return Serial.printf("%g", f);
+    return micros();
+}
+
+// Do not wait for the UART: the interpreter keeps the rest of its output
+// buffer and computes while the FIFO drains
+int hal_output(const char *buffer, int count)
+{
+    if (!Serial)
+        return -1;
+
+    int room = Serial.availableForWrite();
+    if (room <= 0)
+    {
+        yield();
+        return 0;
+    }
+    return Serial.write((const uint8_t *)buffer, count < room ? count : room);
 }
 
 int hal_print_string(const char *s)
@@ -264,10 +280,25 @@ void loop_connected()
 }
 #endif
 
+// Keys translated by os_get_key() and not taken by the interpreter yet
+static char keys[64];
+static size_t keys_len;
+
 void loop()
 {
-    char key = os_get_key();
-    bastos_send_keys((char *)&key, key != 0 ? 1 : 0, true);
+    // Hand all the received keys at once, a pasted program loads at link speed
+    while (keys_len < sizeof(keys))
+    {
+        char key = os_get_key();
+        if (key == 0)
+            break;
+        keys[keys_len++] = key;
+    }
+
+    size_t n = bastos_send_keys(keys, keys_len, true);
+    memmove(keys, keys + n, keys_len - n);
+    keys_len -= n;
+
     bastos_loop();
     if (bastos_is_reset())
     {